@@ -0,0 +1,170 @@
+// Times the compositor on synthetic frames: background replacement and blur
+// on I420 and NV12 at 1080p and 2160p, cut into 1, 2, 4 and 8 row stripes
+// on a thread pool, as the filter runs them on the video thread. The mask
+// is a soft ellipse, so rows have background, foreground and edge spans.
+//
+// Prints one line per case with the mean time per frame.
+
+#include "blend-kernels.h"
+#include "frame-compositor.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+constexpr int kWarmupFrames = 5;
+constexpr int kTimedFrames = 30;
+constexpr int kMaskSize = 256;
+constexpr int kBlurAmount = 15;     // The filter's defaults
+constexpr BlurQuality kBlurQuality = BlurQuality::Balanced;
+constexpr uint32_t kColor = 0xff00ff00;
+
+constexpr int kStripes[] = {1, 2, 4, 8};
+
+struct Size {
+    const char *name;
+    uint32_t width;
+    uint32_t height;
+};
+
+constexpr Size kSizes[] = {{"1080p", 1920, 1080}, {"2160p", 3840, 2160}};
+
+struct Format {
+    const char *name;
+    enum video_format format;
+};
+
+constexpr Format kFormats[] = {{"I420", VIDEO_FORMAT_I420}, {"NV12", VIDEO_FORMAT_NV12}};
+
+enum class Operation { Replace, Blur, BlurTiled };
+
+const char *OperationName(Operation op)
+{
+    switch (op) {
+    case Operation::Replace:
+        return "replace";
+    case Operation::Blur:
+        return "blur";
+    default:
+        return "blur tiled";
+    }
+}
+
+// Upright ellipse with a soft edge a few mask pixels wide, roughly where a
+// person sits in a webcam frame
+cv::Mat MakeMask()
+{
+    cv::Mat mask(kMaskSize, kMaskSize, CV_32FC1);
+    const float cx = kMaskSize * 0.5f;
+    const float cy = kMaskSize * 0.65f;
+    const float rx = kMaskSize * 0.3f;
+    const float ry = kMaskSize * 0.5f;
+    const float edge = 4.0f / kMaskSize;
+    for (int y = 0; y < kMaskSize; y++) {
+        float *row = mask.ptr<float>(y);
+        for (int x = 0; x < kMaskSize; x++) {
+            const float dx = (x - cx) / rx;
+            const float dy = (y - cy) / ry;
+            const float d = 1.0f - std::sqrt(dx * dx + dy * dy);
+            row[x] = std::clamp(d / edge + 0.5f, 0.0f, 1.0f);
+        }
+    }
+    return mask;
+}
+
+// Diagonal gradients, so the blur has something to smooth
+void FillFrame(struct obs_source_frame *frame)
+{
+    const int chroma_rows = static_cast<int>(frame->height / 2);
+    for (uint32_t y = 0; y < frame->height; y++) {
+        uint8_t *row = frame->data[0] + static_cast<size_t>(y) * frame->linesize[0];
+        for (uint32_t x = 0; x < frame->width; x++) {
+            row[x] = static_cast<uint8_t>(16 + (x + y) % 220);
+        }
+    }
+    // I420 has two half-width chroma planes, NV12 one interleaved plane
+    const bool nv12 = frame->format == VIDEO_FORMAT_NV12;
+    const int chroma_planes = nv12 ? 1 : 2;
+    const uint32_t chroma_bytes = nv12 ? frame->width : frame->width / 2;
+    for (int p = 1; p <= chroma_planes; p++) {
+        for (int y = 0; y < chroma_rows; y++) {
+            uint8_t *row = frame->data[p] + static_cast<size_t>(y) * frame->linesize[p];
+            for (uint32_t x = 0; x < chroma_bytes; x++) {
+                row[x] = static_cast<uint8_t>(64 + (x * p + y) % 128);
+            }
+        }
+    }
+}
+
+double TimeFrames(Operation op, struct obs_source_frame *frame, MaskView &mask,
+                  FrameBufferPool &buffers, CompositeColor &color_cache,
+                  const WorkBudget &budget)
+{
+    const uint16_t *color = Compositor::ResolveColor(color_cache, kColor, frame);
+    auto composite = [&]() {
+        switch (op) {
+        case Operation::Replace:
+            Compositor::ReplaceBackground(frame, mask, color, buffers, budget);
+            break;
+        case Operation::Blur:
+        case Operation::BlurTiled:
+            Compositor::BlurBackground(frame, mask, kBlurAmount, kBlurQuality,
+                                       op == Operation::BlurTiled, false, buffers, budget);
+            break;
+        }
+    };
+
+    for (int i = 0; i < kWarmupFrames; i++) {
+        composite();
+    }
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kTimedFrames; i++) {
+        composite();
+    }
+    const std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+    return elapsed.count() / kTimedFrames;
+}
+
+} // namespace
+
+int main()
+{
+    // The caller runs a stripe too, so 8 stripes need 7 workers
+    ThreadPool pool(*std::max_element(std::begin(kStripes), std::end(kStripes)) - 1);
+    BlendKernelSelect::Init();
+
+    const cv::Mat mask_image = MakeMask();
+
+    std::printf("%-6s %-6s %-11s %7s %10s\n", "format", "size", "operation", "stripes",
+                "ms/frame");
+    for (const Format &format : kFormats) {
+        for (const Size &size : kSizes) {
+            struct obs_source_frame *frame =
+                    obs_source_frame_create(format.format, size.width, size.height);
+            FillFrame(frame);
+
+            FrameBufferPool buffers;
+            buffers.Configure(frame);
+            MaskView mask;
+            mask.Reset(&mask_image, 1);
+            CompositeColor color_cache;
+
+            for (Operation op : {Operation::Replace, Operation::Blur, Operation::BlurTiled}) {
+                for (int stripes : kStripes) {
+                    WorkBudget budget;
+                    budget.pool = &pool;
+                    budget.stripes = stripes;
+                    const double ms = TimeFrames(op, frame, mask, buffers, color_cache, budget);
+                    std::printf("%-6s %-6s %-11s %7d %10.2f\n", format.name, size.name,
+                                OperationName(op), stripes, ms);
+                }
+            }
+
+            obs_source_frame_destroy(frame);
+        }
+    }
+    return 0;
+}
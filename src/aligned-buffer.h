@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+// Heap buffer aligned for the widest SIMD loads we use. Resize() only
+// reallocates when the requested size changes, so buffers sized once per
+// model or frame format cost nothing in steady state.
+template <typename T>
+class AlignedBuffer {
+public:
+    static constexpr size_t kAlignment = 64;
+
+    AlignedBuffer() = default;
+    ~AlignedBuffer() { Release(); }
+
+    AlignedBuffer(const AlignedBuffer &) = delete;
+    AlignedBuffer &operator=(const AlignedBuffer &) = delete;
+
+    // Contents are not preserved across a reallocation.
+    // Returns true if memory was (re)allocated.
+    bool Resize(size_t count)
+    {
+        if (count == size_) {
+            return false;
+        }
+
+        Release();
+        if (count > 0) {
+            data_ = static_cast<T *>(
+                    ::operator new(count * sizeof(T), std::align_val_t(kAlignment)));
+            size_ = count;
+        }
+        return true;
+    }
+
+    void Release()
+    {
+        if (data_) {
+            ::operator delete(data_, std::align_val_t(kAlignment));
+        }
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    T *data() { return data_; }
+    const T *data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    T &operator[](size_t i) { return data_[i]; }
+    const T &operator[](size_t i) const { return data_[i]; }
+
+private:
+    T *data_ = nullptr;
+    size_t size_ = 0;
+};
@@ -1,9 +1,103 @@
 #include "background-filter.h"
 #include "security-utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
 #include <opencv2/opencv.hpp>
 #include <util/platform.h>
 #include <util/threading.h>
 
+namespace {
+
+// Masks older than this many source frames mean inference is behind
+constexpr uint64_t kMaxMaskAgeFrames = 3;
+
+// Mean luma change (0..255) from the mask's frame that forces a new
+// inference before the cadence is due
+constexpr float kDriftThreshold = 8.0f;
+
+// The static-scene gate compares luma at 1/8 of model resolution
+constexpr int kGateDownscale = 8;
+
+// The plate takes over once this much of it is learned...
+constexpr float kPlateMinCoverage = 0.6f;
+
+// ...and hands back to the network while its masks differ from the
+// network's by more than this mean alpha
+constexpr float kPlateMaxDisagreement = 0.08f;
+
+// A held frame older than this is not worth repeating
+constexpr uint64_t kMaxHoldNs = 1000000000ULL;
+
+// A gap between source frames longer than this is a pause, not a frame rate
+constexpr uint64_t kMaxFrameDeltaNs = 1000000000ULL;
+
+OverloadPolicy PolicyFromString(const char *name)
+{
+    if (name && strcmp(name, "pass_through") == 0) {
+        return OverloadPolicy::PassThrough;
+    }
+    if (name && strcmp(name, "hold_frame") == 0) {
+        return OverloadPolicy::HoldFrame;
+    }
+    return OverloadPolicy::ReuseMask;
+}
+
+// Nanoseconds per output frame, or 0 when video is not initialized. Read
+// per frame, so a video reset with a new frame rate is picked up.
+uint64_t FrameInterval()
+{
+    struct obs_video_info ovi;
+    if (!obs_get_video_info(&ovi) || ovi.fps_num == 0) {
+        return 0;
+    }
+    return 1000000000ULL * ovi.fps_den / ovi.fps_num;
+}
+
+// Follow the source's own frame rate from its timestamps, smoothed over
+// about eight frames. Pauses and timestamps that jump back (a restarted
+// source) restart the measurement instead of skewing it.
+void TrackSourceInterval(background_filter_data *filter, const struct obs_source_frame *frame)
+{
+    const uint64_t previous = filter->last_frame_timestamp;
+    filter->last_frame_timestamp = frame->timestamp;
+    if (previous == 0 || frame->timestamp <= previous) {
+        return;
+    }
+    
+    const uint64_t delta = frame->timestamp - previous;
+    if (delta > kMaxFrameDeltaNs) {
+        filter->source_interval = 0;
+    } else if (filter->source_interval == 0) {
+        filter->source_interval = delta;
+    } else {
+        filter->source_interval = (filter->source_interval * 7 + delta) / 8;
+    }
+}
+
+// proc_handler: "void get_overload_stats(out int composited, ...)"
+void GetOverloadStats(void *data, calldata_t *cd)
+{
+    auto *filter = static_cast<background_filter_data *>(data);
+    const FilterStats &stats = filter->stats;
+    
+    calldata_set_int(cd, "composited", (long long)stats.GetOutcomeCount(FrameOutcome::Composited));
+    calldata_set_int(cd, "reused_mask", (long long)stats.GetOutcomeCount(FrameOutcome::ReusedMask));
+    calldata_set_int(cd, "passed_through",
+                     (long long)stats.GetOutcomeCount(FrameOutcome::PassedThrough));
+    calldata_set_int(cd, "held_frame", (long long)stats.GetOutcomeCount(FrameOutcome::HeldFrame));
+}
+
+// Returns the frame path to Idle however filter_video exits
+struct ProcessingScope {
+    std::atomic<FilterState> &state;
+    
+    ~ProcessingScope() { state.store(FilterState::Idle, std::memory_order_release); }
+};
+
+} // namespace
+
 const char *background_filter_get_name(void *unused)
 {
     UNUSED_PARAMETER(unused);
@@ -17,8 +111,24 @@ void *background_filter_create(obs_data_t *settings, obs_source_t *source)
     filter->width = 0;
     filter->height = 0;
     filter->model_loaded = false;
-    filter->processing = false;
+    filter->state.store(FilterState::Idle, std::memory_order_relaxed);
     filter->last_process_time = 0;
+    filter->last_frame_timestamp = 0;
+    filter->source_interval = 0;
+    filter->mask_confirmed_timestamp = 0;
+    filter->warned_alpha_fallback = false;
+    filter->held_timestamp = 0;
+    filter->last_submit_timestamp = 0;
+    filter->frames_since_submit = 0;
+    filter->has_submitted = false;
+    filter->drifted = false;
+    filter->blur_valid = false;
+    filter->blur_reference_amount = 0;
+    filter->blur_reference_quality = BlurQuality::Balanced;
+    filter->plate_sequence = UINT64_MAX;
+    filter->plate_generation = 0;
+    filter->plate_trusted = false;
+    filter->roi_sequence = UINT64_MAX;
     
     // Initialize model inference
     filter->inference = std::make_unique<ModelInference>();
@@ -36,6 +146,18 @@ void *background_filter_create(obs_data_t *settings, obs_source_t *source)
     
     background_filter_update(filter, settings);
     
+    // Overload counters, for scripts and tools
+    proc_handler_add(obs_source_get_proc_handler(source),
+                     "void get_overload_stats(out int composited, out int reused_mask, "
+                     "out int passed_through, out int held_frame)",
+                     GetOverloadStats, filter);
+    
+    // Inference runs on its own thread so filter_video only composites
+    if (filter->model_loaded) {
+        filter->worker = std::make_unique<InferenceWorker>(filter->inference.get());
+        filter->worker->Start();
+    }
+    
     return filter;
 }
 
@@ -43,8 +165,18 @@ void background_filter_destroy(void *data)
 {
     auto *filter = static_cast<background_filter_data *>(data);
     
-    // Wait for any ongoing processing
-    std::lock_guard<std::mutex> lock(filter->process_mutex);
+    // Let a frame still in flight finish before anything is torn down
+    FilterState expected = FilterState::Idle;
+    while (!filter->state.compare_exchange_weak(expected, FilterState::ShuttingDown,
+                                                std::memory_order_acq_rel)) {
+        expected = FilterState::Idle;
+        std::this_thread::yield();
+    }
+    
+    // Join the inference thread before the model it uses goes away
+    if (filter->worker) {
+        filter->worker->Stop();
+    }
     
     delete filter;
 }
@@ -67,14 +199,41 @@ void background_filter_update(void *data, obs_data_t *settings)
         edge_smoothing = 3;
     }
     
-    // Apply validated settings
-    filter->threshold = threshold;
-    filter->blur_background = obs_data_get_bool(settings, "blur_background");
-    filter->blur_amount = blur_amount;
-    filter->replace_background = obs_data_get_bool(settings, "replace_background");
-    filter->replacement_color = (uint32_t)obs_data_get_int(settings, "replacement_color");
-    filter->smooth_edges = obs_data_get_bool(settings, "smooth_edges");
-    filter->edge_smoothing = edge_smoothing;
+    // Build a complete snapshot of the validated settings
+    FilterSettings snapshot;
+    snapshot.threshold = threshold;
+    snapshot.blur_background = obs_data_get_bool(settings, "blur_background");
+    snapshot.blur_amount = blur_amount;
+    snapshot.blur_quality = BlurEngine::QualityFromString(
+        obs_data_get_string(settings, "blur_quality"));
+    snapshot.replace_background = obs_data_get_bool(settings, "replace_background");
+    snapshot.replacement_color = (uint32_t)obs_data_get_int(settings, "replacement_color");
+    snapshot.alpha_output = obs_data_get_bool(settings, "alpha_output");
+    snapshot.smooth_edges = obs_data_get_bool(settings, "smooth_edges");
+    snapshot.edge_smoothing = edge_smoothing;
+    snapshot.fixed_point_mask = obs_data_get_bool(settings, "fixed_point_mask");
+    snapshot.cpu_threads = std::clamp((int)obs_data_get_int(settings, "cpu_threads"), 1,
+                                      ThreadPool::kMaxStripes);
+    snapshot.tiled_compositing = obs_data_get_bool(settings, "tiled_compositing");
+    snapshot.overload_policy = PolicyFromString(obs_data_get_string(settings, "overload_policy"));
+    snapshot.inference_every_frames =
+        std::clamp((int)obs_data_get_int(settings, "inference_every_frames"), 1, 30);
+    snapshot.inference_interval_ms =
+        std::clamp((int)obs_data_get_int(settings, "inference_interval_ms"), 0, 2000);
+    snapshot.mask_propagation = obs_data_get_bool(settings, "mask_propagation");
+    snapshot.static_threshold =
+        std::clamp((float)obs_data_get_double(settings, "static_threshold"), 0.0f, 20.0f);
+    snapshot.background_plate = obs_data_get_bool(settings, "background_plate");
+    snapshot.plate_refresh_frames =
+        std::clamp((int)obs_data_get_int(settings, "plate_refresh_frames"), 5, 300);
+    snapshot.roi_tracking = obs_data_get_bool(settings, "roi_tracking");
+    snapshot.edge_refinement = obs_data_get_bool(settings, "edge_refinement");
+    
+    // Publish it; the video thread swaps it in at its next frame. The lock
+    // only orders concurrent updates and is never taken by the video thread.
+    std::lock_guard<std::mutex> lock(filter->update_mutex);
+    filter->settings.WriteSlot() = snapshot;
+    filter->settings.Publish();
 }
 
 obs_properties_t *background_filter_properties(void *data)
@@ -92,18 +251,67 @@ obs_properties_t *background_filter_properties(void *data)
     obs_properties_add_int_slider(props, "blur_amount", 
         "Blur Amount", 1, 50, 1);
     
+    obs_property_t *quality = obs_properties_add_list(props, "blur_quality", 
+        "Blur Quality", OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
+    obs_property_list_add_string(quality, "Fast", "fast");
+    obs_property_list_add_string(quality, "Balanced", "balanced");
+    obs_property_list_add_string(quality, "Reference (Gaussian)", "reference");
+    
     obs_properties_add_bool(props, "replace_background", 
         "Replace Background");
     
     obs_properties_add_color(props, "replacement_color", 
         "Replacement Color");
     
+    obs_properties_add_bool(props, "alpha_output", 
+        "Transparent Background (alpha output)");
+    
     obs_properties_add_bool(props, "smooth_edges", 
         "Smooth Edges");
     
     obs_properties_add_int_slider(props, "edge_smoothing", 
         "Edge Smoothing", 1, 10, 1);
     
+    obs_properties_add_bool(props, "fixed_point_mask", 
+        "8-bit Mask (faster)");
+    
+    obs_properties_add_int_slider(props, "cpu_threads", 
+        "CPU Threads", 1, ThreadPool::kMaxStripes, 1);
+    
+    obs_properties_add_bool(props, "tiled_compositing", 
+        "Tiled Compositing (large frames)");
+    
+    obs_property_t *overload = obs_properties_add_list(props, "overload_policy", 
+        "When Overloaded", OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
+    obs_property_list_add_string(overload, "Reuse Last Mask", "reuse_mask");
+    obs_property_list_add_string(overload, "Hold Last Frame", "hold_frame");
+    obs_property_list_add_string(overload, "Pass Through", "pass_through");
+    
+    obs_properties_add_int_slider(props, "inference_every_frames", 
+        "Run Model Every N Frames", 1, 30, 1);
+    
+    obs_property_t *interval = obs_properties_add_int(props, "inference_interval_ms", 
+        "Run Model Every (ms, 0 = use frames)", 0, 2000, 10);
+    obs_property_int_set_suffix(interval, " ms");
+    
+    obs_properties_add_bool(props, "mask_propagation", 
+        "Warp Mask Between Inferences (optical flow)");
+    
+    obs_properties_add_float_slider(props, "static_threshold", 
+        "Static Scene Threshold (0 = off)", 0.0, 20.0, 0.5);
+    
+    obs_properties_add_bool(props, "background_plate", 
+        "Learn Background Plate (locked-off camera)");
+    
+    obs_properties_add_int_slider(props, "plate_refresh_frames", 
+        "Plate: Re-run Model Every N Frames", 5, 300, 5);
+    
+    obs_properties_add_bool(props, "roi_tracking", 
+        "Track Subject (crop model input)");
+    
+    obs_properties_add_bool(props, "edge_refinement", 
+        "Refine Edges at Full Resolution");
+    
     return props;
 }
 
@@ -112,119 +320,397 @@ void background_filter_defaults(obs_data_t *settings)
     obs_data_set_default_double(settings, "threshold", 0.5);
     obs_data_set_default_bool(settings, "blur_background", false);
     obs_data_set_default_int(settings, "blur_amount", 15);
+    obs_data_set_default_string(settings, "blur_quality", "balanced");
     obs_data_set_default_bool(settings, "replace_background", true);
     obs_data_set_default_int(settings, "replacement_color", 0xFF00FF00); // Green
+    obs_data_set_default_bool(settings, "alpha_output", false);
     obs_data_set_default_bool(settings, "smooth_edges", true);
     obs_data_set_default_int(settings, "edge_smoothing", 3);
+    obs_data_set_default_bool(settings, "fixed_point_mask", false);
+    obs_data_set_default_int(settings, "cpu_threads", 4);
+    obs_data_set_default_bool(settings, "tiled_compositing", false);
+    obs_data_set_default_string(settings, "overload_policy", "reuse_mask");
+    obs_data_set_default_int(settings, "inference_every_frames", 1);
+    obs_data_set_default_int(settings, "inference_interval_ms", 0);
+    obs_data_set_default_bool(settings, "mask_propagation", false);
+    obs_data_set_default_double(settings, "static_threshold", 0.0);
+    obs_data_set_default_bool(settings, "background_plate", false);
+    obs_data_set_default_int(settings, "plate_refresh_frames", 30);
+    obs_data_set_default_bool(settings, "roi_tracking", false);
+    obs_data_set_default_bool(settings, "edge_refinement", false);
+}
+
+namespace {
+
+// Mean absolute difference (0..255) of two gate images; anything that
+// cannot be compared counts as a complete change
+float SceneChange(const cv::Mat &a, const cv::Mat &b, cv::Mat &diff)
+{
+    if (a.empty() || b.empty() || a.size() != b.size()) {
+        return 255.0f;
+    }
+    cv::absdiff(a, b, diff);
+    return static_cast<float>(cv::mean(diff)[0]);
+}
+
+bool TemporalReuse(const FilterSettings &settings)
+{
+    return settings.inference_every_frames > 1 || settings.inference_interval_ms > 0;
+}
+
+// Whether this frame goes to the model. The cadence follows frame
+// timestamps when set in milliseconds, so variable-rate sources are
+// sampled evenly in time; drift away from the last mask cuts it short.
+bool InferenceDue(const background_filter_data *filter, const FilterSettings &settings,
+                  const struct obs_source_frame *frame)
+{
+    if (!filter->has_submitted || filter->drifted) {
+        return true;
+    }
+    
+    // A trusted plate segments every frame; the network only checks it
+    if (settings.background_plate && filter->plate_trusted) {
+        return filter->frames_since_submit + 1 >= settings.plate_refresh_frames;
+    }
+    if (settings.inference_interval_ms > 0) {
+        const uint64_t interval = (uint64_t)settings.inference_interval_ms * 1000000ULL;
+        return frame->timestamp < filter->last_submit_timestamp ||
+               frame->timestamp - filter->last_submit_timestamp >= interval;
+    }
+    return filter->frames_since_submit + 1 >= settings.inference_every_frames;
 }
 
+// A frame region as fractions of the frame size
+cv::Rect2f NormalizedRegion(const cv::Rect &region, const struct obs_source_frame *frame)
+{
+    const float width = (float)frame->width;
+    const float height = (float)frame->height;
+    return cv::Rect2f(region.x / width, region.y / height, region.width / width,
+                      region.height / height);
+}
+
+// Teach the plate with each new network mask and, once it is trusted,
+// segment this frame against it. Every network mask is first scored
+// against what the plate would have produced for the same frame, so a
+// disagreement spike hands segmentation back to the network right away.
+bool UpdatePlate(background_filter_data *filter, const FilterSettings &settings,
+                 const cv::Mat &image)
+{
+    const InferenceResult *result = filter->worker->LatestResult();
+    if (!result) {
+        return false;
+    }
+    
+    if (result->sequence != filter->plate_sequence && !result->image.empty()) {
+        filter->plate_sequence = result->sequence;
+        const float disagreement = filter->plate.Disagreement(result->image, result->mask);
+        filter->plate_trusted = filter->plate.Coverage() >= kPlateMinCoverage &&
+                                disagreement <= kPlateMaxDisagreement;
+        filter->plate.Learn(result->image, result->mask);
+    }
+    if (!filter->plate_trusted) {
+        return false;
+    }
+    
+    filter->plate.Segment(image, result->mask, filter->plate_mask, settings.fixed_point_mask);
+    filter->plate_generation++;
+    return true;
+}
+
+// Composite one frame with the newest mask, or apply the overload policy.
+// The frame path is behind when the previous frame took longer than one
+// output interval. Inference is behind when the newest mask is several
+// source frames older than the cadence allows; both are measured in the
+// source's own frames, since that is what the cadence counts.
+FrameOutcome CompositeFrame(background_filter_data *filter, const FilterSettings &settings,
+                            struct obs_source_frame *frame, const WorkBudget &budget,
+                            bool plate_active, bool &blur_reused)
+{
+    blur_reused = false;
+    
+    // Until the first mask arrives the frame passes through
+    const InferenceResult *result = filter->worker->LatestResult();
+    if (!result) {
+        return FrameOutcome::PassedThrough;
+    }
+    
+    // Until the source's rate is measured, assume it matches the output
+    const uint64_t output_interval = FrameInterval();
+    const uint64_t source_interval = filter->source_interval > 0 ? filter->source_interval
+                                                                 : output_interval;
+    const uint64_t cadence =
+        settings.inference_interval_ms > 0
+            ? (uint64_t)settings.inference_interval_ms * 1000000ULL
+            : (uint64_t)(settings.inference_every_frames - 1) * source_interval;
+    const bool late = output_interval > 0 && filter->last_process_time > output_interval;
+    
+    // A mask the static gate confirmed still fits this scene, so its age
+    // counts from the confirmation (ignored once timestamps jump back)
+    uint64_t mask_time = result->timestamp;
+    if (filter->mask_confirmed_timestamp <= frame->timestamp) {
+        mask_time = std::max(mask_time, filter->mask_confirmed_timestamp);
+    }
+    const bool stale = !plate_active && source_interval > 0 &&
+                       frame->timestamp > mask_time + cadence +
+                                                  kMaxMaskAgeFrames * source_interval;
+    const bool overloaded = late || stale;
+    
+    if (overloaded && settings.overload_policy == OverloadPolicy::PassThrough) {
+        return FrameOutcome::PassedThrough;
+    }
+    if (overloaded && settings.overload_policy == OverloadPolicy::HoldFrame) {
+        const bool recent = frame->timestamp >= filter->held_timestamp &&
+                            frame->timestamp - filter->held_timestamp <= kMaxHoldNs;
+        if (recent && Compositor::RestoreFrame(frame, filter->buffers)) {
+            return FrameOutcome::HeldFrame;
+        }
+        return FrameOutcome::PassedThrough;
+    }
+    
+    // Between inferences the mask is checked against this frame, and
+    // optionally warped onto it
+    const cv::Mat *mask = &result->mask;
+    uint64_t generation = result->sequence;
+    cv::Rect region = result->region;
+    const bool reuse = TemporalReuse(settings) || settings.mask_propagation;
+    if (plate_active) {
+        // The plate segmented this very frame
+        mask = &filter->plate_mask;
+        generation = filter->plate_generation;
+        region = filter->sample_region;
+    } else if (reuse && result->timestamp != frame->timestamp && !result->luma.empty() &&
+               result->luma.size() == filter->frame_luma.size() &&
+               result->region == filter->sample_region) {
+        mask = &filter->propagator.Propagate(result->mask, result->luma, filter->frame_luma,
+                                             settings.mask_propagation);
+        filter->drifted = TemporalReuse(settings) &&
+                          filter->propagator.Drift() > kDriftThreshold;
+        if (settings.mask_propagation) {
+            generation = filter->propagator.Generation();
+        }
+    }
+    
+    // The mask stays at model resolution; the compositor interpolates
+    // it one row at a time while blending
+    filter->mask.Reset(mask, generation, NormalizedRegion(region, frame));
+    
+    // Re-matte the boundary at full resolution before anything is blended
+    if (settings.edge_refinement && MaskRefiner::SupportsFormat(frame->format)) {
+        filter->mask.SetDetail(&filter->refiner.Refine(frame, filter->mask, budget));
+        filter->buffers.CountTraffic(filter->refiner.BytesRead(), 0);
+    } else {
+        filter->mask.SetDetail(nullptr);
+    }
+    
+    // Alpha output leaves colour alone and hands the mask on as alpha.
+    // Formats without an alpha variant get the replacement colour instead.
+    const bool alpha_written = settings.alpha_output &&
+                               Compositor::WriteAlpha(frame, filter->mask, filter->buffers,
+                                                      budget);
+    
+    // Blend straight into the frame's own planes; no conversion back
+    if (alpha_written) {
+        // Nothing to blend; whatever renders the frame applies the alpha
+    } else if (settings.replace_background || settings.alpha_output) {
+        const uint16_t *color = Compositor::ResolveColor(
+            filter->replacement_cache, settings.replacement_color, frame);
+        Compositor::ReplaceBackground(frame, filter->mask, color, filter->buffers, budget);
+    } else if (settings.blur_background) {
+        // A static scene keeps the blurred background of the frame it was
+        // blurred from, as long as the blur itself has not changed
+        const bool gate = settings.static_threshold > 0.0f;
+        blur_reused = gate && filter->blur_valid &&
+                      filter->blur_reference_amount == settings.blur_amount &&
+                      filter->blur_reference_quality == settings.blur_quality &&
+                      SceneChange(filter->gate_luma, filter->blur_reference,
+                                  filter->gate_diff) < settings.static_threshold;
+        
+        const bool whole_planes = Compositor::BlurBackground(
+            frame, filter->mask, settings.blur_amount, settings.blur_quality,
+            settings.tiled_compositing, blur_reused, filter->buffers, budget);
+        
+        filter->blur_valid = gate && whole_planes;
+        if (filter->blur_valid && !blur_reused) {
+            filter->gate_luma.copyTo(filter->blur_reference);
+            filter->blur_reference_amount = settings.blur_amount;
+            filter->blur_reference_quality = settings.blur_quality;
+        }
+    }
+    
+    // Only pay for the copy when it may be repeated
+    if (settings.overload_policy == OverloadPolicy::HoldFrame) {
+        Compositor::SaveFrame(frame, filter->buffers);
+        filter->held_timestamp = frame->timestamp;
+    }
+    
+    return overloaded ? FrameOutcome::ReusedMask : FrameOutcome::Composited;
+}
+
+} // namespace
+
 struct obs_source_frame *background_filter_video(void *data, struct obs_source_frame *frame)
 {
     auto *filter = static_cast<background_filter_data *>(data);
     
-    if (!filter->model_loaded || filter->processing) {
+    if (!filter->model_loaded) {
+        return frame;
+    }
+    
+    // Never wait: a frame that arrives while another is in flight, or
+    // during teardown, passes through untouched
+    FilterState expected = FilterState::Idle;
+    if (!filter->state.compare_exchange_strong(expected, FilterState::Processing,
+                                               std::memory_order_acq_rel)) {
         return frame;
     }
+    ProcessingScope scope{filter->state};
     
-    std::lock_guard<std::mutex> lock(filter->process_mutex);
-    filter->processing = true;
+    // Adopt the newest settings snapshot, if any, for this whole frame
+    filter->settings.Acquire();
+    const FilterSettings &settings = filter->settings.ReadSlot();
     
-    // Update dimensions if changed
-    if (filter->width != frame->width || filter->height != frame->height) {
+    // Scratch buffers follow the frame layout; steady state allocates nothing
+    if (filter->buffers.Configure(frame)) {
+        filter->blur_valid = false;
+        filter->plate.Reset();
+        filter->plate_trusted = false;
+        filter->roi.Reset();
         filter->width = frame->width;
         filter->height = frame->height;
+        blog(LOG_DEBUG, "[Background Filter] Frame buffers sized for %ux%u",
+             filter->width, filter->height);
+        filter->warned_alpha_fallback = false;
+    }
+    
+    // Say once per format, and again each time alpha output is turned on,
+    // that this source cannot carry alpha
+    if (!settings.alpha_output) {
+        filter->warned_alpha_fallback = false;
+    } else if (!filter->warned_alpha_fallback && Compositor::SupportsFormat(frame->format) &&
+               !Compositor::SupportsAlpha(frame->format)) {
+        blog(LOG_INFO, "[Background Filter] Source format has no alpha variant; "
+             "using the replacement color instead");
+        filter->warned_alpha_fallback = true;
     }
     
     try {
-        // Convert OBS frame to OpenCV Mat
-        cv::Mat input_frame;
+        if (!Compositor::SupportsFormat(frame->format)) {
+            return frame;
+        }
+        
+        filter->stats.BeginFrame();
+        TrackSourceInterval(filter, frame);
+        
+        // Hand a model-sized RGB sample of the frame to the inference
+        // thread; it picks up whichever frame is newest once it finishes the
+        // previous one. The full frame is never converted.
+        int model_height, model_width;
+        filter->inference->GetInputShape(model_height, model_width);
+        
+        // Per-pixel work is cut into row stripes on the shared pool
+        WorkBudget budget;
+        budget.pool = ThreadPool::Global();
+        budget.stripes = settings.cpu_threads;
         
-        if (frame->format == VIDEO_FORMAT_I420) {
-            // Convert I420 to BGR
-            cv::Mat yuv(frame->height + frame->height / 2, frame->width, CV_8UC1, frame->data[0]);
-            cv::cvtColor(yuv, input_frame, cv::COLOR_YUV2BGR_I420);
-        } else if (frame->format == VIDEO_FORMAT_NV12) {
-            // Convert NV12 to BGR
-            cv::Mat yuv(frame->height + frame->height / 2, frame->width, CV_8UC1, frame->data[0]);
-            cv::cvtColor(yuv, input_frame, cv::COLOR_YUV2BGR_NV12);
-        } else if (frame->format == VIDEO_FORMAT_RGBA) {
-            input_frame = cv::Mat(frame->height, frame->width, CV_8UC4, frame->data[0]);
-            cv::cvtColor(input_frame, input_frame, cv::COLOR_RGBA2BGR);
+        // With tracking on, the sample covers the region fitted to the
+        // newest mask instead of the whole frame
+        if (settings.roi_tracking && !settings.background_plate) {
+            const InferenceResult *result = filter->worker->LatestResult();
+            if (result && result->sequence != filter->roi_sequence) {
+                filter->roi_sequence = result->sequence;
+                filter->roi.Update(result->mask, result->region, frame->width, frame->height,
+                                   cv::Size(model_width, model_height));
+            }
         } else {
-            // Unsupported format
-            filter->processing = false;
-            return frame;
+            filter->roi.Reset();
         }
+        filter->sample_region = filter->roi.Region(frame->width, frame->height);
         
-        // Run inference to get mask
-        cv::Mat mask;
-        if (!filter->inference->RunInference(input_frame, mask, filter->threshold)) {
-            filter->processing = false;
-            return frame;
+        InferenceJob &job = filter->worker->JobSlot();
+        filter->sampler.Sample(frame, filter->sample_region, model_width, model_height,
+                               job.image, budget);
+        filter->buffers.CountTraffic(Compositor::FrameBytes(frame), 0);
+        
+        // Luma for drift checks, flow and the static gate, from the same
+        // small sample
+        const bool reuse = TemporalReuse(settings) || settings.mask_propagation;
+        const bool gate = settings.static_threshold > 0.0f;
+        if (reuse || gate) {
+            filter->sampler.Luma(filter->frame_luma);
         }
         
-        // Apply edge smoothing
-        if (filter->smooth_edges && filter->edge_smoothing > 0) {
-            cv::GaussianBlur(mask, mask, 
-                cv::Size(filter->edge_smoothing * 2 + 1, filter->edge_smoothing * 2 + 1), 
-                0);
+        // Plate mode works on the sample still sitting in the job slot,
+        // so it runs before the job is handed over
+        bool plate_active = false;
+        if (settings.background_plate) {
+            plate_active = UpdatePlate(filter, settings, job.image);
+        } else if (filter->plate_trusted || filter->plate.Coverage() > 0.0f) {
+            filter->plate.Reset();
+            filter->plate_trusted = false;
         }
         
-        // Process frame based on settings
-        cv::Mat output_frame = input_frame.clone();
+        bool inference_skipped = false;
+        bool due = InferenceDue(filter, settings, frame);
+        if (gate) {
+            cv::resize(filter->frame_luma, filter->gate_luma,
+                       cv::Size(std::max(model_width / kGateDownscale, 1),
+                                std::max(model_height / kGateDownscale, 1)),
+                       0, 0, cv::INTER_AREA);
+            
+            // Nothing has moved since the model last looked: keep its mask
+            if (due && filter->has_submitted && !filter->drifted &&
+                SceneChange(filter->gate_luma, filter->gate_reference,
+                            filter->gate_diff) < settings.static_threshold) {
+                due = false;
+                inference_skipped = true;
+                filter->mask_confirmed_timestamp = frame->timestamp;
+            }
+        }
         
-        if (filter->replace_background) {
-            // Replace background with solid color
-            cv::Vec3b bg_color(
-                (filter->replacement_color >> 0) & 0xFF,   // B
-                (filter->replacement_color >> 8) & 0xFF,   // G
-                (filter->replacement_color >> 16) & 0xFF   // R
-            );
+        if (due) {
+            job.threshold = settings.threshold;
             
-            for (int y = 0; y < output_frame.rows; y++) {
-                for (int x = 0; x < output_frame.cols; x++) {
-                    float alpha = mask.at<float>(y, x);
-                    output_frame.at<cv::Vec3b>(y, x) = 
-                        output_frame.at<cv::Vec3b>(y, x) * alpha + 
-                        bg_color * (1.0f - alpha);
-                }
+            // Smoothing happens on the model-sized mask, so scale the radius
+            job.edge_smoothing = 0;
+            if (settings.smooth_edges && settings.edge_smoothing > 0) {
+                job.edge_smoothing = std::max(1, (int)std::lround(
+                    (double)settings.edge_smoothing * model_width / frame->width));
+            }
+            job.fixed_point = settings.fixed_point_mask;
+            job.timestamp = frame->timestamp;
+            job.return_image = settings.background_plate;
+            job.region = filter->sample_region;
+            if (reuse) {
+                filter->frame_luma.copyTo(job.luma);
+            } else {
+                job.luma.release();
             }
-        } else if (filter->blur_background) {
-            // Blur background
-            cv::Mat blurred;
-            int kernel_size = filter->blur_amount * 2 + 1;
-            cv::GaussianBlur(input_frame, blurred, cv::Size(kernel_size, kernel_size), 0);
+            filter->worker->SubmitJob();
             
-            for (int y = 0; y < output_frame.rows; y++) {
-                for (int x = 0; x < output_frame.cols; x++) {
-                    float alpha = mask.at<float>(y, x);
-                    output_frame.at<cv::Vec3b>(y, x) = 
-                        input_frame.at<cv::Vec3b>(y, x) * alpha + 
-                        blurred.at<cv::Vec3b>(y, x) * (1.0f - alpha);
-                }
+            filter->last_submit_timestamp = frame->timestamp;
+            filter->frames_since_submit = 0;
+            filter->has_submitted = true;
+            filter->drifted = false;
+            if (gate) {
+                filter->gate_luma.copyTo(filter->gate_reference);
             }
+        } else {
+            filter->frames_since_submit++;
         }
         
-        // Convert back to original format
-        if (frame->format == VIDEO_FORMAT_I420 || frame->format == VIDEO_FORMAT_NV12) {
-            cv::Mat yuv_output;
-            if (frame->format == VIDEO_FORMAT_I420) {
-                cv::cvtColor(output_frame, yuv_output, cv::COLOR_BGR2YUV_I420);
-            } else {
-                cv::cvtColor(output_frame, yuv_output, cv::COLOR_BGR2YUV_NV12);
-            }
-            memcpy(frame->data[0], yuv_output.data, yuv_output.total() * yuv_output.elemSize());
-        } else if (frame->format == VIDEO_FORMAT_RGBA) {
-            cv::Mat rgba_output;
-            cv::cvtColor(output_frame, rgba_output, cv::COLOR_BGR2RGBA);
-            memcpy(frame->data[0], rgba_output.data, rgba_output.total() * rgba_output.elemSize());
+        bool blur_reused = false;
+        const FrameOutcome outcome =
+            CompositeFrame(filter, settings, frame, budget, plate_active, blur_reused);
+        if (gate) {
+            filter->stats.CountGate(inference_skipped, blur_reused);
         }
+        filter->last_process_time = filter->stats.EndFrame(
+            frame, filter->buffers.TakeTraffic(), settings.tiled_compositing, outcome);
         
     } catch (const std::exception &e) {
         blog(LOG_ERROR, "[Background Filter] Error processing frame: %s", e.what());
     }
     
-    filter->processing = false;
     return frame;
 }
 
@@ -1,8 +1,66 @@
 #pragma once
 
 #include <obs-module.h>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include "background-plate.h"
+#include "filter-stats.h"
+#include "frame-buffer-pool.h"
+#include "frame-compositor.h"
+#include "frame-sampler.h"
+#include "inference-worker.h"
+#include "mask-propagator.h"
+#include "mask-refiner.h"
+#include "mask-view.h"
 #include "model-inference.h"
+#include "roi-tracker.h"
+#include "thread-pool.h"
+#include "triple-buffer.h"
+
+// What to do with frames while the filter cannot keep up
+enum class OverloadPolicy {
+    PassThrough,    // Leave them unfiltered
+    ReuseMask,      // Keep compositing with the newest mask, however old
+    HoldFrame,      // Repeat the last composited frame
+};
+
+// One consistent set of settings. background_filter_update builds a whole
+// snapshot and publishes it; the video thread adopts the newest one at the
+// start of a frame and reads only that for the rest of it, so an update
+// never blocks a frame or changes values halfway through one.
+struct FilterSettings {
+    float threshold = 0.5f;
+    bool blur_background = false;
+    int blur_amount = 15;
+    BlurQuality blur_quality = BlurQuality::Balanced;
+    bool replace_background = true;
+    uint32_t replacement_color = 0xFF00FF00;
+    bool alpha_output = false;          // Write the mask as alpha instead of blending
+    bool smooth_edges = true;
+    int edge_smoothing = 3;
+    bool fixed_point_mask = false;      // 8-bit mask and integer blending
+    int cpu_threads = 4;                // Row stripes per frame on the shared pool
+    bool tiled_compositing = false;     // Fused band-by-band blur and blend
+    OverloadPolicy overload_policy = OverloadPolicy::ReuseMask;
+    int inference_every_frames = 1;     // Model cadence in frames...
+    int inference_interval_ms = 0;      // ...or in time when non-zero
+    bool mask_propagation = false;      // Warp reused masks along optical flow
+    float static_threshold = 0.0f;      // Mean luma change counted as static, 0 = off
+    bool background_plate = false;      // Segment by plate differencing between inferences
+    int plate_refresh_frames = 30;      // Model cadence while the plate is trusted
+    bool roi_tracking = false;          // Feed the model a crop around the subject
+    bool edge_refinement = false;       // Re-matte mask edges at full resolution
+};
+
+// Lifecycle of the frame path. filter_video only runs from Idle, so a
+// re-entrant or overlapping call passes its frame through instead of
+// waiting, and destroy moves to ShuttingDown once no frame is in flight.
+enum class FilterState : uint8_t {
+    Idle,
+    Processing,
+    ShuttingDown,
+};
 
 struct background_filter_data {
     obs_source_t *context;
@@ -10,26 +68,70 @@ struct background_filter_data {
     // Model inference engine
     std::unique_ptr<ModelInference> inference;
     
-    // Filter settings
-    float threshold;
-    bool blur_background;
-    int blur_amount;
-    bool replace_background;
-    uint32_t replacement_color;
-    bool smooth_edges;
-    int edge_smoothing;
+    // Runs the model off the video thread; declared after `inference` so it
+    // is torn down first
+    std::unique_ptr<InferenceWorker> worker;
+    
+    // Filter settings: written by update, read by the video thread
+    TripleBuffer<FilterSettings> settings;
+    std::mutex update_mutex;            // Serializes publishers only
+    CompositeColor replacement_cache;   // replacement_color in frame color space
     
     // Video format
     uint32_t width;
     uint32_t height;
     
+    // Frame-sized scratch, resized only when width/height/format change
+    FrameBufferPool buffers;
+    
+    // Model input sampled straight from the frame planes
+    FrameSampler sampler;
+    
+    // Latest model-resolution mask, upsampled lazily by the compositor
+    MaskView mask;
+    MaskRefiner refiner;
+    
+    // Temporal reuse: the mask is carried across frames the model skips
+    MaskPropagator propagator;
+    cv::Mat frame_luma;                 // Model-resolution luma of this frame
+    uint64_t last_submit_timestamp;
+    int frames_since_submit;
+    bool has_submitted;
+    bool drifted;                       // Scene moved away from the last mask
+    
+    // Static-scene gate: tiny luma images compared by mean absolute difference
+    cv::Mat gate_luma;                  // This frame
+    cv::Mat gate_reference;             // Last frame sent to the model
+    cv::Mat blur_reference;             // Frame the pooled blurred planes came from
+    cv::Mat gate_diff;
+    uint64_t mask_confirmed_timestamp;  // Last frame the gate kept the mask for
+    bool blur_valid;                    // Pooled blurred planes may be reused
+    int blur_reference_amount;
+    BlurQuality blur_reference_quality;
+    
+    // Background plate taught by the network's masks
+    BackgroundPlate plate;
+    cv::Mat plate_mask;                 // This frame's plate segmentation
+    uint64_t plate_sequence;            // Last network mask learned from
+    uint64_t plate_generation;
+    bool plate_trusted;                 // Covered enough and agreeing with the network
+    
+    // Model input cropped to the subject
+    RoiTracker roi;
+    cv::Rect sample_region;             // Region this frame was sampled from
+    uint64_t roi_sequence;              // Last mask the region was fitted to
+    
     // Performance tracking
+    FilterStats stats;
     uint64_t last_process_time;
+    uint64_t last_frame_timestamp;
+    uint64_t source_interval;           // Measured source frame delta, 0 until known
+    uint64_t held_timestamp;            // Timestamp of the frame kept for HoldFrame
     bool model_loaded;
+    bool warned_alpha_fallback;         // Logged that this format gets colour, not alpha
     
     // Threading
-    bool processing;
-    std::mutex process_mutex;
+    std::atomic<FilterState> state;
 };
 
 // Plugin functions
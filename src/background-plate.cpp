@@ -0,0 +1,129 @@
+#include "background-plate.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Network alpha below this is background confident enough to learn from
+constexpr float kLearnBelow = 0.1f;
+
+// Samples before a plate pixel is trusted
+constexpr int kMinSamples = 3;
+
+// Slowest adaptation rate, so lighting drift is followed
+constexpr float kMinRate = 0.05f;
+
+// Largest channel difference (0..255) mapped to alpha 0 and alpha 1
+constexpr float kDifferenceLow = 12.0f;
+constexpr float kDifferenceHigh = 36.0f;
+
+inline float MaskAt(const cv::Mat &mask, int y, int x)
+{
+    return mask.type() == CV_8UC1 ? mask.ptr<uint8_t>(y)[x] * (1.0f / 255.0f)
+                                  : mask.ptr<float>(y)[x];
+}
+
+} // namespace
+
+BackgroundPlate::BackgroundPlate() : coverage_(0.0f) {}
+
+void BackgroundPlate::Reset()
+{
+    plate_.release();
+    samples_.release();
+    coverage_ = 0.0f;
+}
+
+void BackgroundPlate::Learn(const cv::Mat &rgb, const cv::Mat &teacher)
+{
+    if (plate_.rows != rgb.rows || plate_.cols != rgb.cols) {
+        plate_.create(rgb.rows, rgb.cols, CV_32FC3);
+        samples_ = cv::Mat::zeros(rgb.rows, rgb.cols, CV_8UC1);
+    }
+
+    int trusted = 0;
+    for (int y = 0; y < rgb.rows; y++) {
+        const uint8_t *in = rgb.ptr<uint8_t>(y);
+        float *plate = plate_.ptr<float>(y);
+        uint8_t *samples = samples_.ptr<uint8_t>(y);
+
+        for (int x = 0; x < rgb.cols; x++) {
+            if (MaskAt(teacher, y, x) < kLearnBelow) {
+                // Running mean that settles into an exponential average
+                const float rate = std::max(1.0f / (samples[x] + 1), kMinRate);
+                for (int c = 0; c < 3; c++) {
+                    plate[x * 3 + c] += (in[x * 3 + c] - plate[x * 3 + c]) * rate;
+                }
+                samples[x] = static_cast<uint8_t>(std::min(samples[x] + 1, 255));
+            }
+            trusted += samples[x] >= kMinSamples ? 1 : 0;
+        }
+    }
+
+    coverage_ = static_cast<float>(trusted) / static_cast<float>(rgb.rows * rgb.cols);
+}
+
+void BackgroundPlate::Segment(const cv::Mat &rgb, const cv::Mat &fallback, cv::Mat &mask,
+                              bool fixed_point)
+{
+    alpha_.create(rgb.rows, rgb.cols, CV_8UC1);
+    const bool has_plate = plate_.rows == rgb.rows && plate_.cols == rgb.cols;
+    const bool has_fallback = fallback.rows == rgb.rows && fallback.cols == rgb.cols;
+    const float scale = 255.0f / (kDifferenceHigh - kDifferenceLow);
+
+    for (int y = 0; y < rgb.rows; y++) {
+        const uint8_t *in = rgb.ptr<uint8_t>(y);
+        uint8_t *out = alpha_.ptr<uint8_t>(y);
+        const float *plate = has_plate ? plate_.ptr<float>(y) : nullptr;
+        const uint8_t *samples = has_plate ? samples_.ptr<uint8_t>(y) : nullptr;
+
+        for (int x = 0; x < rgb.cols; x++) {
+            if (!has_plate || samples[x] < kMinSamples) {
+                const float alpha = has_fallback ? MaskAt(fallback, y, x) : 1.0f;
+                out[x] = static_cast<uint8_t>(alpha * 255.0f + 0.5f);
+                continue;
+            }
+
+            float difference = 0.0f;
+            for (int c = 0; c < 3; c++) {
+                difference = std::max(difference, std::fabs(in[x * 3 + c] - plate[x * 3 + c]));
+            }
+            out[x] = static_cast<uint8_t>(
+                    std::clamp((difference - kDifferenceLow) * scale, 0.0f, 255.0f) + 0.5f);
+        }
+    }
+
+    // Sensor noise leaves isolated speckles; a small median removes them
+    // without moving the subject's outline
+    cv::medianBlur(alpha_, filtered_, 3);
+
+    if (fixed_point) {
+        filtered_.copyTo(mask);
+    } else {
+        filtered_.convertTo(mask, CV_32F, 1.0 / 255.0);
+    }
+}
+
+float BackgroundPlate::Disagreement(const cv::Mat &rgb, const cv::Mat &teacher)
+{
+    if (plate_.rows != rgb.rows || plate_.cols != rgb.cols) {
+        return 0.0f;
+    }
+
+    Segment(rgb, teacher, student_, false);
+
+    double total = 0.0;
+    int count = 0;
+    for (int y = 0; y < rgb.rows; y++) {
+        const float *student = student_.ptr<float>(y);
+        const uint8_t *samples = samples_.ptr<uint8_t>(y);
+        for (int x = 0; x < rgb.cols; x++) {
+            if (samples[x] >= kMinSamples) {
+                total += std::fabs(student[x] - MaskAt(teacher, y, x));
+                count++;
+            }
+        }
+    }
+
+    return count > 0 ? static_cast<float>(total / count) : 0.0f;
+}
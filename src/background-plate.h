@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+
+// Model-resolution background plate for locked-off cameras. Pixels the
+// network classifies as confident background are averaged into an RGB
+// plate; once enough of the frame has been seen, a mask is had by
+// differencing a frame against the plate, at a tiny fraction of the cost
+// of the network. Pixels the plate has never seen (typically behind the
+// subject) fall back to the network's latest mask.
+class BackgroundPlate {
+public:
+    BackgroundPlate();
+
+    // Forget everything learned, e.g. after the model input size changes
+    void Reset();
+
+    /**
+     * Learn from a frame the network segmented
+     * @param rgb Model input (CV_8UC3)
+     * @param teacher Network mask for it (CV_32FC1 or CV_8UC1)
+     */
+    void Learn(const cv::Mat &rgb, const cv::Mat &teacher);
+
+    /**
+     * Segment a frame by differencing it against the plate
+     * @param rgb Model input (CV_8UC3)
+     * @param fallback Mask used where the plate has no data
+     * @param mask Receives the mask, CV_8UC1 if fixed_point, else CV_32FC1
+     * @param fixed_point Output type selector
+     */
+    void Segment(const cv::Mat &rgb, const cv::Mat &fallback, cv::Mat &mask, bool fixed_point);
+
+    /**
+     * How far plate differencing is from the network on a frame the
+     * network segmented; call before Learn() with the same frame
+     * @param rgb Model input (CV_8UC3)
+     * @param teacher Network mask for it
+     * @return Mean absolute alpha difference over learned pixels, 0..1
+     */
+    float Disagreement(const cv::Mat &rgb, const cv::Mat &teacher);
+
+    // Fraction of plate pixels with enough samples to be trusted
+    float Coverage() const { return coverage_; }
+
+private:
+    cv::Mat plate_;         // CV_32FC3 running mean
+    cv::Mat samples_;       // CV_8UC1 samples per pixel, saturating
+    cv::Mat alpha_;         // CV_8UC1 differencing result
+    cv::Mat filtered_;
+    cv::Mat student_;       // CV_32FC1, for Disagreement()
+    float coverage_;
+};
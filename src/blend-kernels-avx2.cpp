@@ -0,0 +1,458 @@
+// Compiled with AVX2 enabled; only reached after CPUID says it is safe
+#include "blend-kernels.h"
+#include <immintrin.h>
+#include <cstring>
+
+namespace {
+
+// Alpha for the eight byte lanes starting at byte offset `byte`
+template <int C, int B>
+inline __m256 LaneAlpha(const float *alpha, int byte)
+{
+    if constexpr (C == 1) {
+        return _mm256_loadu_ps(alpha + byte);
+    } else if constexpr (C == 2) {
+        const __m256 a = _mm256_castps128_ps256(_mm_loadu_ps(alpha + byte / 2));
+        return _mm256_permutevar8x32_ps(a, _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3));
+    } else {
+        const __m256 a = _mm256_castps128_ps256(
+                _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double *>(alpha + byte / 4))));
+        __m256 expanded = _mm256_permutevar8x32_ps(a, _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1));
+        if constexpr (B == 3) {
+            expanded = _mm256_blend_ps(expanded, _mm256_set1_ps(1.0f), 0x88);
+        }
+        return expanded;
+    }
+}
+
+template <int C, int B>
+inline __m256 LaneColor(const uint8_t *color)
+{
+    if constexpr (C == 1) {
+        return _mm256_set1_ps(color[0]);
+    } else if constexpr (C == 2) {
+        return _mm256_setr_ps(color[0], color[1], color[0], color[1], color[0], color[1],
+                              color[0], color[1]);
+    } else {
+        const float last = B == 4 ? color[3] : 0.0f;
+        return _mm256_setr_ps(color[0], color[1], color[2], last, color[0], color[1], color[2],
+                              last);
+    }
+}
+
+// Bytes 8Q..8Q+7 widened to int32
+template <int Q>
+inline __m256i Quarter(__m256i v)
+{
+    const __m128i half = Q < 2 ? _mm256_castsi256_si128(v) : _mm256_extracti128_si256(v, 1);
+    return _mm256_cvtepu8_epi32(Q % 2 ? _mm_srli_si128(half, 8) : half);
+}
+
+inline __m256i Lerp(__m256i fg, __m256 bg, __m256 a)
+{
+    const __m256 f = _mm256_cvtepi32_ps(fg);
+    // Multiply and add round separately, as in the other tables
+    return _mm256_cvtps_epi32(_mm256_add_ps(bg, _mm256_mul_ps(_mm256_sub_ps(f, bg), a)));
+}
+
+// Pack four int32x8 vectors back into 32 bytes in their original order
+inline __m256i Pack(__m256i r0, __m256i r1, __m256i r2, __m256i r3)
+{
+    const __m256i p = _mm256_packus_epi16(_mm256_packus_epi32(r0, r1),
+                                          _mm256_packus_epi32(r2, r3));
+    return _mm256_permutevar8x32_epi32(p, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+}
+
+template <int C, int B, bool Solid>
+void BlendRow(uint8_t *row, const uint8_t *background, const float *alpha, int width,
+              const uint8_t *color)
+{
+    const int bytes = width * C;
+    __m256 color8 = _mm256_setzero_ps();
+    if constexpr (Solid) {
+        color8 = LaneColor<C, B>(color);
+    }
+    int i = 0;
+
+    for (; i + 32 <= bytes; i += 32) {
+        const __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + i));
+        __m256 bg0 = color8, bg1 = color8, bg2 = color8, bg3 = color8;
+
+        if constexpr (!Solid) {
+            const __m256i bg =
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i *>(background + i));
+            bg0 = _mm256_cvtepi32_ps(Quarter<0>(bg));
+            bg1 = _mm256_cvtepi32_ps(Quarter<1>(bg));
+            bg2 = _mm256_cvtepi32_ps(Quarter<2>(bg));
+            bg3 = _mm256_cvtepi32_ps(Quarter<3>(bg));
+        }
+
+        const __m256i r0 = Lerp(Quarter<0>(px), bg0, LaneAlpha<C, B>(alpha, i));
+        const __m256i r1 = Lerp(Quarter<1>(px), bg1, LaneAlpha<C, B>(alpha, i + 8));
+        const __m256i r2 = Lerp(Quarter<2>(px), bg2, LaneAlpha<C, B>(alpha, i + 16));
+        const __m256i r3 = Lerp(Quarter<3>(px), bg3, LaneAlpha<C, B>(alpha, i + 24));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(row + i), Pack(r0, r1, r2, r3));
+    }
+
+    // Leftover pixels go through the SSE4.1 kernel, which ends in scalar
+    const int done = i / C;
+    if constexpr (Solid) {
+        kBlendKernelsSSE41.blend_color(row + i, alpha + done, width - done, C, B, color);
+    } else {
+        kBlendKernelsSSE41.blend_background(row + i, background + i, alpha + done,
+                                            width - done, C, B);
+    }
+}
+
+void BlendColor(uint8_t *row, const float *alpha, int width, int channels, int blend_channels,
+                const uint8_t *color)
+{
+    if (channels == 1) {
+        BlendRow<1, 1, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRow<2, 2, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 4 && blend_channels == 3) {
+        BlendRow<4, 3, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 4 && blend_channels == 4) {
+        BlendRow<4, 4, true>(row, nullptr, alpha, width, color);
+    } else {
+        kBlendKernelsScalar.blend_color(row, alpha, width, channels, blend_channels, color);
+    }
+}
+
+void BlendBackground(uint8_t *row, const uint8_t *background, const float *alpha, int width,
+                     int channels, int blend_channels)
+{
+    if (channels == 1) {
+        BlendRow<1, 1, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRow<2, 2, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 4 && blend_channels == 3) {
+        BlendRow<4, 3, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 4 && blend_channels == 4) {
+        BlendRow<4, 4, false>(row, background, alpha, width, nullptr);
+    } else {
+        kBlendKernelsScalar.blend_background(row, background, alpha, width, channels,
+                                             blend_channels);
+    }
+}
+
+// Fixed-point path: 32 byte lanes at a time. unpack/pack work per 128-bit
+// half, so widening with unpacklo/hi and narrowing with packus keeps order.
+
+template <int C, int B>
+inline __m256i LaneAlphaQ(const uint8_t *alpha, int byte)
+{
+    if constexpr (C == 1) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(alpha + byte));
+    } else if constexpr (C == 2) {
+        const __m256i w = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(alpha + byte / 2)));
+        return _mm256_or_si256(w, _mm256_slli_epi16(w, 8));
+    } else {
+        __m256i a = _mm256_mullo_epi32(
+                _mm256_cvtepu8_epi32(
+                        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(alpha + byte / 4))),
+                _mm256_set1_epi32(0x01010101));
+        if constexpr (B == 3) {
+            a = _mm256_or_si256(a, _mm256_set1_epi32(static_cast<int>(0xFF000000u)));
+        }
+        return a;
+    }
+}
+
+template <int C, int B>
+inline __m256i LaneColorQ(const uint8_t *color)
+{
+    if constexpr (C == 1) {
+        return _mm256_set1_epi8(static_cast<char>(color[0]));
+    } else if constexpr (C == 2) {
+        return _mm256_set1_epi16(static_cast<short>(color[0] | color[1] << 8));
+    } else {
+        const uint32_t last = B == 4 ? color[3] : 0;
+        return _mm256_set1_epi32(static_cast<int>(color[0] | color[1] << 8 | color[2] << 16 |
+                                                  last << 24));
+    }
+}
+
+inline __m256i LerpQ(__m256i fg, __m256i bg, __m256i a)
+{
+    a = _mm256_add_epi16(a, _mm256_srli_epi16(a, 7));
+    const __m256i inv = _mm256_sub_epi16(_mm256_set1_epi16(256), a);
+    const __m256i sum = _mm256_add_epi16(_mm256_mullo_epi16(fg, a), _mm256_mullo_epi16(bg, inv));
+    return _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_set1_epi16(128)), 8);
+}
+
+template <int C, int B, bool Solid>
+void BlendRowQ(uint8_t *row, const uint8_t *background, const uint8_t *alpha, int width,
+               const uint8_t *color)
+{
+    const int bytes = width * C;
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i bg = zero;
+    if constexpr (Solid) {
+        bg = LaneColorQ<C, B>(color);
+    }
+    int i = 0;
+
+    for (; i + 32 <= bytes; i += 32) {
+        const __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + i));
+        const __m256i a = LaneAlphaQ<C, B>(alpha, i);
+        if constexpr (!Solid) {
+            bg = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(background + i));
+        }
+
+        const __m256i lo = LerpQ(_mm256_unpacklo_epi8(px, zero), _mm256_unpacklo_epi8(bg, zero),
+                                 _mm256_unpacklo_epi8(a, zero));
+        const __m256i hi = LerpQ(_mm256_unpackhi_epi8(px, zero), _mm256_unpackhi_epi8(bg, zero),
+                                 _mm256_unpackhi_epi8(a, zero));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(row + i), _mm256_packus_epi16(lo, hi));
+    }
+
+    const int done = i / C;
+    if constexpr (Solid) {
+        kBlendKernelsSSE41.blend_color_q(row + i, alpha + done, width - done, C, B, color);
+    } else {
+        kBlendKernelsSSE41.blend_background_q(row + i, background + i, alpha + done,
+                                              width - done, C, B);
+    }
+}
+
+void BlendColorQ(uint8_t *row, const uint8_t *alpha, int width, int channels,
+                 int blend_channels, const uint8_t *color)
+{
+    if (channels == 1) {
+        BlendRowQ<1, 1, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRowQ<2, 2, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 4 && blend_channels == 3) {
+        BlendRowQ<4, 3, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 4 && blend_channels == 4) {
+        BlendRowQ<4, 4, true>(row, nullptr, alpha, width, color);
+    } else {
+        kBlendKernelsScalar.blend_color_q(row, alpha, width, channels, blend_channels, color);
+    }
+}
+
+void BlendBackgroundQ(uint8_t *row, const uint8_t *background, const uint8_t *alpha, int width,
+                      int channels, int blend_channels)
+{
+    if (channels == 1) {
+        BlendRowQ<1, 1, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRowQ<2, 2, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 4 && blend_channels == 3) {
+        BlendRowQ<4, 3, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 4 && blend_channels == 4) {
+        BlendRowQ<4, 4, false>(row, background, alpha, width, nullptr);
+    } else {
+        kBlendKernelsScalar.blend_background_q(row, background, alpha, width, channels,
+                                               blend_channels);
+    }
+}
+
+// 16-bit samples: sixteen lanes at a time, one or two channels. packus
+// works per 128-bit half, so its result is put back in order with a
+// 64-bit permute.
+
+template <int C>
+inline __m256 LaneColor16(const uint16_t *color)
+{
+    return C == 1 ? _mm256_set1_ps(color[0])
+                  : _mm256_setr_ps(color[0], color[1], color[0], color[1], color[0], color[1],
+                                   color[0], color[1]);
+}
+
+// Alpha for the eight sample lanes starting at `sample`, as int32
+template <int C>
+inline __m256i LaneAlpha16Q(const uint8_t *alpha, int sample)
+{
+    if constexpr (C == 1) {
+        return _mm256_cvtepu8_epi32(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i *>(alpha + sample)));
+    } else {
+        int32_t packed;
+        memcpy(&packed, alpha + sample / 2, sizeof(packed));
+        const __m256i a = _mm256_cvtepu8_epi32(_mm_cvtsi32_si128(packed));
+        return _mm256_permutevar8x32_epi32(a, _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3));
+    }
+}
+
+inline __m256i LerpQ16(__m256i fg, __m256i bg, __m256i a)
+{
+    a = _mm256_add_epi32(a, _mm256_srli_epi32(a, 7));
+    const __m256i inv = _mm256_sub_epi32(_mm256_set1_epi32(256), a);
+    const __m256i sum =
+            _mm256_add_epi32(_mm256_mullo_epi32(fg, a), _mm256_mullo_epi32(bg, inv));
+    return _mm256_srli_epi32(_mm256_add_epi32(sum, _mm256_set1_epi32(128)), 8);
+}
+
+inline __m256i Widen16(__m256i v, int half)
+{
+    return _mm256_cvtepu16_epi32(half ? _mm256_extracti128_si256(v, 1)
+                                      : _mm256_castsi256_si128(v));
+}
+
+inline __m256i Pack16(__m256i r0, __m256i r1)
+{
+    return _mm256_permute4x64_epi64(_mm256_packus_epi32(r0, r1), _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+template <int C, bool Solid>
+void BlendRow16(uint16_t *row, const uint16_t *background, const float *alpha, int width,
+                const uint16_t *color)
+{
+    const int samples = width * C;
+    __m256 color8 = _mm256_setzero_ps();
+    if constexpr (Solid) {
+        color8 = LaneColor16<C>(color);
+    }
+    int i = 0;
+
+    for (; i + 16 <= samples; i += 16) {
+        const __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + i));
+        __m256 bg0 = color8, bg1 = color8;
+
+        if constexpr (!Solid) {
+            const __m256i bg =
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i *>(background + i));
+            bg0 = _mm256_cvtepi32_ps(Widen16(bg, 0));
+            bg1 = _mm256_cvtepi32_ps(Widen16(bg, 1));
+        }
+
+        const __m256i r0 = Lerp(Widen16(px, 0), bg0, LaneAlpha<C, C>(alpha, i));
+        const __m256i r1 = Lerp(Widen16(px, 1), bg1, LaneAlpha<C, C>(alpha, i + 8));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(row + i), Pack16(r0, r1));
+    }
+
+    const int done = i / C;
+    if constexpr (Solid) {
+        kBlendKernelsSSE41.blend_color16(row + i, alpha + done, width - done, C, C, color);
+    } else {
+        kBlendKernelsSSE41.blend_background16(row + i, background + i, alpha + done,
+                                              width - done, C, C);
+    }
+}
+
+template <int C, bool Solid>
+void BlendRow16Q(uint16_t *row, const uint16_t *background, const uint8_t *alpha, int width,
+                 const uint16_t *color)
+{
+    const int samples = width * C;
+    __m256i color8 = _mm256_setzero_si256();
+    if constexpr (Solid) {
+        color8 = _mm256_cvtps_epi32(LaneColor16<C>(color));
+    }
+    int i = 0;
+
+    for (; i + 16 <= samples; i += 16) {
+        const __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + i));
+        __m256i bg0 = color8, bg1 = color8;
+
+        if constexpr (!Solid) {
+            const __m256i bg =
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i *>(background + i));
+            bg0 = Widen16(bg, 0);
+            bg1 = Widen16(bg, 1);
+        }
+
+        const __m256i r0 = LerpQ16(Widen16(px, 0), bg0, LaneAlpha16Q<C>(alpha, i));
+        const __m256i r1 = LerpQ16(Widen16(px, 1), bg1, LaneAlpha16Q<C>(alpha, i + 8));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(row + i), Pack16(r0, r1));
+    }
+
+    const int done = i / C;
+    if constexpr (Solid) {
+        kBlendKernelsSSE41.blend_color16_q(row + i, alpha + done, width - done, C, C, color);
+    } else {
+        kBlendKernelsSSE41.blend_background16_q(row + i, background + i, alpha + done,
+                                                width - done, C, C);
+    }
+}
+
+void BlendColor16(uint16_t *row, const float *alpha, int width, int channels,
+                  int blend_channels, const uint16_t *color)
+{
+    if (channels == 1) {
+        BlendRow16<1, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRow16<2, true>(row, nullptr, alpha, width, color);
+    } else {
+        kBlendKernelsScalar.blend_color16(row, alpha, width, channels, blend_channels, color);
+    }
+}
+
+void BlendBackground16(uint16_t *row, const uint16_t *background, const float *alpha,
+                       int width, int channels, int blend_channels)
+{
+    if (channels == 1) {
+        BlendRow16<1, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRow16<2, false>(row, background, alpha, width, nullptr);
+    } else {
+        kBlendKernelsScalar.blend_background16(row, background, alpha, width, channels,
+                                               blend_channels);
+    }
+}
+
+void BlendColor16Q(uint16_t *row, const uint8_t *alpha, int width, int channels,
+                   int blend_channels, const uint16_t *color)
+{
+    if (channels == 1) {
+        BlendRow16Q<1, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRow16Q<2, true>(row, nullptr, alpha, width, color);
+    } else {
+        kBlendKernelsScalar.blend_color16_q(row, alpha, width, channels, blend_channels, color);
+    }
+}
+
+void BlendBackground16Q(uint16_t *row, const uint16_t *background, const uint8_t *alpha,
+                        int width, int channels, int blend_channels)
+{
+    if (channels == 1) {
+        BlendRow16Q<1, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRow16Q<2, false>(row, background, alpha, width, nullptr);
+    } else {
+        kBlendKernelsScalar.blend_background16_q(row, background, alpha, width, channels,
+                                                 blend_channels);
+    }
+}
+
+void StoreAlpha(uint8_t *dst, const float *alpha, int width, int pixel_stride)
+{
+    int x = 0;
+
+    if (pixel_stride == 1) {
+        const __m256 scale = _mm256_set1_ps(255.0f);
+        for (; x + 32 <= width; x += 32) {
+            const __m256i a0 = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(alpha + x), scale));
+            const __m256i a1 =
+                    _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(alpha + x + 8), scale));
+            const __m256i a2 =
+                    _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(alpha + x + 16), scale));
+            const __m256i a3 =
+                    _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(alpha + x + 24), scale));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), Pack(a0, a1, a2, a3));
+        }
+    }
+
+    kBlendKernelsSSE41.store_alpha(dst + x * pixel_stride, alpha + x, width - x, pixel_stride);
+}
+
+} // namespace
+
+const BlendKernels kBlendKernelsAVX2 = {
+    "avx2",
+    BlendColor,
+    BlendBackground,
+    BlendColorQ,
+    BlendBackgroundQ,
+    BlendColor16,
+    BlendBackground16,
+    BlendColor16Q,
+    BlendBackground16Q,
+    StoreAlpha,
+};
@@ -0,0 +1,440 @@
+// Compiled with AVX-512F/BW enabled; only reached after CPUID says it is safe
+#include "blend-kernels.h"
+#include <immintrin.h>
+
+namespace {
+
+// Alpha for the sixteen byte lanes starting at byte offset `byte`
+template <int C, int B>
+inline __m512 LaneAlpha(const float *alpha, int byte)
+{
+    if constexpr (C == 1) {
+        return _mm512_loadu_ps(alpha + byte);
+    } else if constexpr (C == 2) {
+        const __m512 a = _mm512_castps256_ps512(_mm256_loadu_ps(alpha + byte / 2));
+        return _mm512_permutexvar_ps(
+                _mm512_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7), a);
+    } else {
+        const __m512 a = _mm512_castps128_ps512(_mm_loadu_ps(alpha + byte / 4));
+        __m512 expanded = _mm512_permutexvar_ps(
+                _mm512_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3), a);
+        if constexpr (B == 3) {
+            expanded = _mm512_mask_blend_ps(0x8888, expanded, _mm512_set1_ps(1.0f));
+        }
+        return expanded;
+    }
+}
+
+template <int C, int B>
+inline __m512 LaneColor(const uint8_t *color)
+{
+    if constexpr (C == 1) {
+        return _mm512_set1_ps(color[0]);
+    } else if constexpr (C == 2) {
+        const float c0 = color[0], c1 = color[1];
+        return _mm512_setr_ps(c0, c1, c0, c1, c0, c1, c0, c1, c0, c1, c0, c1, c0, c1, c0, c1);
+    } else {
+        const float c0 = color[0], c1 = color[1], c2 = color[2];
+        const float c3 = B == 4 ? color[3] : 0.0f;
+        return _mm512_setr_ps(c0, c1, c2, c3, c0, c1, c2, c3, c0, c1, c2, c3, c0, c1, c2, c3);
+    }
+}
+
+// Bytes 16Q..16Q+15 widened to int32
+template <int Q>
+inline __m512i Quarter(__m512i v)
+{
+    return _mm512_cvtepu8_epi32(_mm512_extracti32x4_epi32(v, Q));
+}
+
+// Blend and narrow to bytes; the clamp at zero keeps the unsigned
+// saturating narrow from turning a rounding underflow into 255
+inline __m128i Lerp(__m512i fg, __m512 bg, __m512 a)
+{
+    const __m512 f = _mm512_cvtepi32_ps(fg);
+    // Multiply and add round separately, as in the other tables
+    const __m512 mixed = _mm512_add_ps(bg, _mm512_mul_ps(_mm512_sub_ps(f, bg), a));
+    const __m512i v = _mm512_cvtps_epi32(mixed);
+    return _mm512_cvtusepi32_epi8(_mm512_max_epi32(v, _mm512_setzero_si512()));
+}
+
+template <int C, int B, bool Solid>
+void BlendRow(uint8_t *row, const uint8_t *background, const float *alpha, int width,
+              const uint8_t *color)
+{
+    const int bytes = width * C;
+    __m512 color16 = _mm512_setzero_ps();
+    if constexpr (Solid) {
+        color16 = LaneColor<C, B>(color);
+    }
+    int i = 0;
+
+    for (; i + 64 <= bytes; i += 64) {
+        const __m512i px = _mm512_loadu_si512(row + i);
+        __m512 bg0 = color16, bg1 = color16, bg2 = color16, bg3 = color16;
+
+        if constexpr (!Solid) {
+            const __m512i bg = _mm512_loadu_si512(background + i);
+            bg0 = _mm512_cvtepi32_ps(Quarter<0>(bg));
+            bg1 = _mm512_cvtepi32_ps(Quarter<1>(bg));
+            bg2 = _mm512_cvtepi32_ps(Quarter<2>(bg));
+            bg3 = _mm512_cvtepi32_ps(Quarter<3>(bg));
+        }
+
+        __m128i *out = reinterpret_cast<__m128i *>(row + i);
+        _mm_storeu_si128(out + 0, Lerp(Quarter<0>(px), bg0, LaneAlpha<C, B>(alpha, i)));
+        _mm_storeu_si128(out + 1, Lerp(Quarter<1>(px), bg1, LaneAlpha<C, B>(alpha, i + 16)));
+        _mm_storeu_si128(out + 2, Lerp(Quarter<2>(px), bg2, LaneAlpha<C, B>(alpha, i + 32)));
+        _mm_storeu_si128(out + 3, Lerp(Quarter<3>(px), bg3, LaneAlpha<C, B>(alpha, i + 48)));
+    }
+
+    // Leftover pixels go through the AVX2 kernel, which cascades down
+    const int done = i / C;
+    if constexpr (Solid) {
+        kBlendKernelsAVX2.blend_color(row + i, alpha + done, width - done, C, B, color);
+    } else {
+        kBlendKernelsAVX2.blend_background(row + i, background + i, alpha + done, width - done,
+                                           C, B);
+    }
+}
+
+void BlendColor(uint8_t *row, const float *alpha, int width, int channels, int blend_channels,
+                const uint8_t *color)
+{
+    if (channels == 1) {
+        BlendRow<1, 1, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRow<2, 2, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 4 && blend_channels == 3) {
+        BlendRow<4, 3, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 4 && blend_channels == 4) {
+        BlendRow<4, 4, true>(row, nullptr, alpha, width, color);
+    } else {
+        kBlendKernelsScalar.blend_color(row, alpha, width, channels, blend_channels, color);
+    }
+}
+
+void BlendBackground(uint8_t *row, const uint8_t *background, const float *alpha, int width,
+                     int channels, int blend_channels)
+{
+    if (channels == 1) {
+        BlendRow<1, 1, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRow<2, 2, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 4 && blend_channels == 3) {
+        BlendRow<4, 3, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 4 && blend_channels == 4) {
+        BlendRow<4, 4, false>(row, background, alpha, width, nullptr);
+    } else {
+        kBlendKernelsScalar.blend_background(row, background, alpha, width, channels,
+                                             blend_channels);
+    }
+}
+
+// Fixed-point path: 64 byte lanes at a time, same in-lane unpack/pack
+// trick as the AVX2 version
+
+template <int C, int B>
+inline __m512i LaneAlphaQ(const uint8_t *alpha, int byte)
+{
+    if constexpr (C == 1) {
+        return _mm512_loadu_si512(alpha + byte);
+    } else if constexpr (C == 2) {
+        const __m512i w = _mm512_cvtepu8_epi16(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(alpha + byte / 2)));
+        return _mm512_or_si512(w, _mm512_slli_epi16(w, 8));
+    } else {
+        __m512i a = _mm512_mullo_epi32(
+                _mm512_cvtepu8_epi32(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(alpha + byte / 4))),
+                _mm512_set1_epi32(0x01010101));
+        if constexpr (B == 3) {
+            a = _mm512_or_si512(a, _mm512_set1_epi32(static_cast<int>(0xFF000000u)));
+        }
+        return a;
+    }
+}
+
+template <int C, int B>
+inline __m512i LaneColorQ(const uint8_t *color)
+{
+    if constexpr (C == 1) {
+        return _mm512_set1_epi8(static_cast<char>(color[0]));
+    } else if constexpr (C == 2) {
+        return _mm512_set1_epi16(static_cast<short>(color[0] | color[1] << 8));
+    } else {
+        const uint32_t last = B == 4 ? color[3] : 0;
+        return _mm512_set1_epi32(static_cast<int>(color[0] | color[1] << 8 | color[2] << 16 |
+                                                  last << 24));
+    }
+}
+
+inline __m512i LerpQ(__m512i fg, __m512i bg, __m512i a)
+{
+    a = _mm512_add_epi16(a, _mm512_srli_epi16(a, 7));
+    const __m512i inv = _mm512_sub_epi16(_mm512_set1_epi16(256), a);
+    const __m512i sum = _mm512_add_epi16(_mm512_mullo_epi16(fg, a), _mm512_mullo_epi16(bg, inv));
+    return _mm512_srli_epi16(_mm512_add_epi16(sum, _mm512_set1_epi16(128)), 8);
+}
+
+template <int C, int B, bool Solid>
+void BlendRowQ(uint8_t *row, const uint8_t *background, const uint8_t *alpha, int width,
+               const uint8_t *color)
+{
+    const int bytes = width * C;
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i bg = zero;
+    if constexpr (Solid) {
+        bg = LaneColorQ<C, B>(color);
+    }
+    int i = 0;
+
+    for (; i + 64 <= bytes; i += 64) {
+        const __m512i px = _mm512_loadu_si512(row + i);
+        const __m512i a = LaneAlphaQ<C, B>(alpha, i);
+        if constexpr (!Solid) {
+            bg = _mm512_loadu_si512(background + i);
+        }
+
+        const __m512i lo = LerpQ(_mm512_unpacklo_epi8(px, zero), _mm512_unpacklo_epi8(bg, zero),
+                                 _mm512_unpacklo_epi8(a, zero));
+        const __m512i hi = LerpQ(_mm512_unpackhi_epi8(px, zero), _mm512_unpackhi_epi8(bg, zero),
+                                 _mm512_unpackhi_epi8(a, zero));
+        _mm512_storeu_si512(row + i, _mm512_packus_epi16(lo, hi));
+    }
+
+    const int done = i / C;
+    if constexpr (Solid) {
+        kBlendKernelsAVX2.blend_color_q(row + i, alpha + done, width - done, C, B, color);
+    } else {
+        kBlendKernelsAVX2.blend_background_q(row + i, background + i, alpha + done,
+                                             width - done, C, B);
+    }
+}
+
+void BlendColorQ(uint8_t *row, const uint8_t *alpha, int width, int channels,
+                 int blend_channels, const uint8_t *color)
+{
+    if (channels == 1) {
+        BlendRowQ<1, 1, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRowQ<2, 2, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 4 && blend_channels == 3) {
+        BlendRowQ<4, 3, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 4 && blend_channels == 4) {
+        BlendRowQ<4, 4, true>(row, nullptr, alpha, width, color);
+    } else {
+        kBlendKernelsScalar.blend_color_q(row, alpha, width, channels, blend_channels, color);
+    }
+}
+
+void BlendBackgroundQ(uint8_t *row, const uint8_t *background, const uint8_t *alpha, int width,
+                      int channels, int blend_channels)
+{
+    if (channels == 1) {
+        BlendRowQ<1, 1, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRowQ<2, 2, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 4 && blend_channels == 3) {
+        BlendRowQ<4, 3, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 4 && blend_channels == 4) {
+        BlendRowQ<4, 4, false>(row, background, alpha, width, nullptr);
+    } else {
+        kBlendKernelsScalar.blend_background_q(row, background, alpha, width, channels,
+                                               blend_channels);
+    }
+}
+
+// 16-bit samples: sixteen lanes at a time, one or two channels, narrowed
+// back with the same clamp and saturating convert as the byte path
+
+template <int C>
+inline __m512 LaneColor16(const uint16_t *color)
+{
+    if constexpr (C == 1) {
+        return _mm512_set1_ps(color[0]);
+    } else {
+        const float c0 = color[0], c1 = color[1];
+        return _mm512_setr_ps(c0, c1, c0, c1, c0, c1, c0, c1, c0, c1, c0, c1, c0, c1, c0, c1);
+    }
+}
+
+// Alpha for the sixteen sample lanes starting at `sample`, as int32
+template <int C>
+inline __m512i LaneAlpha16Q(const uint8_t *alpha, int sample)
+{
+    if constexpr (C == 1) {
+        return _mm512_cvtepu8_epi32(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(alpha + sample)));
+    } else {
+        const __m512i a = _mm512_cvtepu8_epi32(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i *>(alpha + sample / 2)));
+        return _mm512_permutexvar_epi32(
+                _mm512_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7), a);
+    }
+}
+
+inline __m256i Narrow16(__m512i v)
+{
+    return _mm512_cvtusepi32_epi16(_mm512_max_epi32(v, _mm512_setzero_si512()));
+}
+
+inline __m256i Lerp16(__m512i fg, __m512 bg, __m512 a)
+{
+    const __m512 f = _mm512_cvtepi32_ps(fg);
+    const __m512 mixed = _mm512_add_ps(bg, _mm512_mul_ps(_mm512_sub_ps(f, bg), a));
+    return Narrow16(_mm512_cvtps_epi32(mixed));
+}
+
+inline __m256i LerpQ16(__m512i fg, __m512i bg, __m512i a)
+{
+    a = _mm512_add_epi32(a, _mm512_srli_epi32(a, 7));
+    const __m512i inv = _mm512_sub_epi32(_mm512_set1_epi32(256), a);
+    const __m512i sum =
+            _mm512_add_epi32(_mm512_mullo_epi32(fg, a), _mm512_mullo_epi32(bg, inv));
+    return Narrow16(_mm512_srli_epi32(_mm512_add_epi32(sum, _mm512_set1_epi32(128)), 8));
+}
+
+inline __m512i Load16(const uint16_t *samples)
+{
+    return _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(samples)));
+}
+
+template <int C, bool Solid>
+void BlendRow16(uint16_t *row, const uint16_t *background, const float *alpha, int width,
+                const uint16_t *color)
+{
+    const int samples = width * C;
+    __m512 color16 = _mm512_setzero_ps();
+    if constexpr (Solid) {
+        color16 = LaneColor16<C>(color);
+    }
+    int i = 0;
+
+    for (; i + 16 <= samples; i += 16) {
+        __m512 bg = color16;
+        if constexpr (!Solid) {
+            bg = _mm512_cvtepi32_ps(Load16(background + i));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(row + i),
+                            Lerp16(Load16(row + i), bg, LaneAlpha<C, C>(alpha, i)));
+    }
+
+    const int done = i / C;
+    if constexpr (Solid) {
+        kBlendKernelsAVX2.blend_color16(row + i, alpha + done, width - done, C, C, color);
+    } else {
+        kBlendKernelsAVX2.blend_background16(row + i, background + i, alpha + done,
+                                             width - done, C, C);
+    }
+}
+
+template <int C, bool Solid>
+void BlendRow16Q(uint16_t *row, const uint16_t *background, const uint8_t *alpha, int width,
+                 const uint16_t *color)
+{
+    const int samples = width * C;
+    __m512i color16 = _mm512_setzero_si512();
+    if constexpr (Solid) {
+        color16 = _mm512_cvtps_epi32(LaneColor16<C>(color));
+    }
+    int i = 0;
+
+    for (; i + 16 <= samples; i += 16) {
+        __m512i bg = color16;
+        if constexpr (!Solid) {
+            bg = Load16(background + i);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(row + i),
+                            LerpQ16(Load16(row + i), bg, LaneAlpha16Q<C>(alpha, i)));
+    }
+
+    const int done = i / C;
+    if constexpr (Solid) {
+        kBlendKernelsAVX2.blend_color16_q(row + i, alpha + done, width - done, C, C, color);
+    } else {
+        kBlendKernelsAVX2.blend_background16_q(row + i, background + i, alpha + done,
+                                               width - done, C, C);
+    }
+}
+
+void BlendColor16(uint16_t *row, const float *alpha, int width, int channels,
+                  int blend_channels, const uint16_t *color)
+{
+    if (channels == 1) {
+        BlendRow16<1, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRow16<2, true>(row, nullptr, alpha, width, color);
+    } else {
+        kBlendKernelsScalar.blend_color16(row, alpha, width, channels, blend_channels, color);
+    }
+}
+
+void BlendBackground16(uint16_t *row, const uint16_t *background, const float *alpha,
+                       int width, int channels, int blend_channels)
+{
+    if (channels == 1) {
+        BlendRow16<1, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRow16<2, false>(row, background, alpha, width, nullptr);
+    } else {
+        kBlendKernelsScalar.blend_background16(row, background, alpha, width, channels,
+                                               blend_channels);
+    }
+}
+
+void BlendColor16Q(uint16_t *row, const uint8_t *alpha, int width, int channels,
+                   int blend_channels, const uint16_t *color)
+{
+    if (channels == 1) {
+        BlendRow16Q<1, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRow16Q<2, true>(row, nullptr, alpha, width, color);
+    } else {
+        kBlendKernelsScalar.blend_color16_q(row, alpha, width, channels, blend_channels, color);
+    }
+}
+
+void BlendBackground16Q(uint16_t *row, const uint16_t *background, const uint8_t *alpha,
+                        int width, int channels, int blend_channels)
+{
+    if (channels == 1) {
+        BlendRow16Q<1, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRow16Q<2, false>(row, background, alpha, width, nullptr);
+    } else {
+        kBlendKernelsScalar.blend_background16_q(row, background, alpha, width, channels,
+                                                 blend_channels);
+    }
+}
+
+void StoreAlpha(uint8_t *dst, const float *alpha, int width, int pixel_stride)
+{
+    int x = 0;
+
+    if (pixel_stride == 1) {
+        const __m512 scale = _mm512_set1_ps(255.0f);
+        for (; x + 16 <= width; x += 16) {
+            __m512i a = _mm512_cvtps_epi32(_mm512_mul_ps(_mm512_loadu_ps(alpha + x), scale));
+            a = _mm512_max_epi32(a, _mm512_setzero_si512());
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm512_cvtusepi32_epi8(a));
+        }
+    }
+
+    kBlendKernelsAVX2.store_alpha(dst + x * pixel_stride, alpha + x, width - x, pixel_stride);
+}
+
+} // namespace
+
+const BlendKernels kBlendKernelsAVX512 = {
+    "avx512",
+    BlendColor,
+    BlendBackground,
+    BlendColorQ,
+    BlendBackgroundQ,
+    BlendColor16,
+    BlendBackground16,
+    BlendColor16Q,
+    BlendBackground16Q,
+    StoreAlpha,
+};
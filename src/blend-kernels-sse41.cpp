@@ -0,0 +1,421 @@
+// Compiled with SSE4.1 enabled; only reached after CPUID says it is safe
+#include "blend-kernels.h"
+#include <smmintrin.h>
+#include <cstring>
+
+namespace {
+
+// Alpha for the four byte lanes starting at byte offset `byte`
+template <int C, int B>
+inline __m128 LaneAlpha(const float *alpha, int byte)
+{
+    if constexpr (C == 1) {
+        return _mm_loadu_ps(alpha + byte);
+    } else if constexpr (C == 2) {
+        __m128 a = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double *>(alpha + byte / 2)));
+        return _mm_unpacklo_ps(a, a);
+    } else {
+        __m128 a = _mm_set1_ps(alpha[byte / 4]);
+        if constexpr (B == 3) {
+            a = _mm_blend_ps(a, _mm_set1_ps(1.0f), 0x8);
+        }
+        return a;
+    }
+}
+
+template <int C, int B>
+inline __m128 LaneColor(const uint8_t *color)
+{
+    if constexpr (C == 1) {
+        return _mm_set1_ps(color[0]);
+    } else if constexpr (C == 2) {
+        return _mm_setr_ps(color[0], color[1], color[0], color[1]);
+    } else {
+        return _mm_setr_ps(color[0], color[1], color[2], B == 4 ? color[3] : 0.0f);
+    }
+}
+
+// Bytes 4Q..4Q+3 widened to int32
+template <int Q>
+inline __m128i Quarter(__m128i v)
+{
+    return _mm_cvtepu8_epi32(_mm_srli_si128(v, Q * 4));
+}
+
+inline __m128i Lerp(__m128i fg, __m128 bg, __m128 a)
+{
+    const __m128 f = _mm_cvtepi32_ps(fg);
+    return _mm_cvtps_epi32(_mm_add_ps(bg, _mm_mul_ps(_mm_sub_ps(f, bg), a)));
+}
+
+template <int C, int B, bool Solid>
+void BlendRow(uint8_t *row, const uint8_t *background, const float *alpha, int width,
+              const uint8_t *color)
+{
+    const int bytes = width * C;
+    const __m128 color4 = Solid ? LaneColor<C, B>(color) : _mm_setzero_ps();
+    int i = 0;
+
+    for (; i + 16 <= bytes; i += 16) {
+        const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i));
+        __m128 bg0 = color4, bg1 = color4, bg2 = color4, bg3 = color4;
+
+        if constexpr (!Solid) {
+            const __m128i bg =
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(background + i));
+            bg0 = _mm_cvtepi32_ps(Quarter<0>(bg));
+            bg1 = _mm_cvtepi32_ps(Quarter<1>(bg));
+            bg2 = _mm_cvtepi32_ps(Quarter<2>(bg));
+            bg3 = _mm_cvtepi32_ps(Quarter<3>(bg));
+        }
+
+        const __m128i r0 = Lerp(Quarter<0>(px), bg0, LaneAlpha<C, B>(alpha, i));
+        const __m128i r1 = Lerp(Quarter<1>(px), bg1, LaneAlpha<C, B>(alpha, i + 4));
+        const __m128i r2 = Lerp(Quarter<2>(px), bg2, LaneAlpha<C, B>(alpha, i + 8));
+        const __m128i r3 = Lerp(Quarter<3>(px), bg3, LaneAlpha<C, B>(alpha, i + 12));
+
+        const __m128i packed =
+                _mm_packus_epi16(_mm_packus_epi32(r0, r1), _mm_packus_epi32(r2, r3));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(row + i), packed);
+    }
+
+    // i is a whole number of pixels here since 16 is a multiple of C
+    const int done = i / C;
+    if constexpr (Solid) {
+        kBlendKernelsScalar.blend_color(row + i, alpha + done, width - done, C, B, color);
+    } else {
+        kBlendKernelsScalar.blend_background(row + i, background + i, alpha + done,
+                                             width - done, C, B);
+    }
+}
+
+void BlendColor(uint8_t *row, const float *alpha, int width, int channels, int blend_channels,
+                const uint8_t *color)
+{
+    if (channels == 1) {
+        BlendRow<1, 1, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRow<2, 2, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 4 && blend_channels == 3) {
+        BlendRow<4, 3, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 4 && blend_channels == 4) {
+        BlendRow<4, 4, true>(row, nullptr, alpha, width, color);
+    } else {
+        kBlendKernelsScalar.blend_color(row, alpha, width, channels, blend_channels, color);
+    }
+}
+
+void BlendBackground(uint8_t *row, const uint8_t *background, const float *alpha, int width,
+                     int channels, int blend_channels)
+{
+    if (channels == 1) {
+        BlendRow<1, 1, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRow<2, 2, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 4 && blend_channels == 3) {
+        BlendRow<4, 3, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 4 && blend_channels == 4) {
+        BlendRow<4, 4, false>(row, background, alpha, width, nullptr);
+    } else {
+        kBlendKernelsScalar.blend_background(row, background, alpha, width, channels,
+                                             blend_channels);
+    }
+}
+
+// Fixed-point path: sixteen byte lanes at a time, blended in 16-bit lanes
+
+template <int C, int B>
+inline __m128i LaneAlphaQ(const uint8_t *alpha, int byte)
+{
+    if constexpr (C == 1) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(alpha + byte));
+    } else if constexpr (C == 2) {
+        const __m128i w = _mm_cvtepu8_epi16(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i *>(alpha + byte / 2)));
+        return _mm_or_si128(w, _mm_slli_epi16(w, 8));
+    } else {
+        int32_t packed;
+        memcpy(&packed, alpha + byte / 4, sizeof(packed));
+        __m128i a = _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed)),
+                                    _mm_set1_epi32(0x01010101));
+        if constexpr (B == 3) {
+            a = _mm_or_si128(a, _mm_set1_epi32(static_cast<int>(0xFF000000u)));
+        }
+        return a;
+    }
+}
+
+template <int C, int B>
+inline __m128i LaneColorQ(const uint8_t *color)
+{
+    if constexpr (C == 1) {
+        return _mm_set1_epi8(static_cast<char>(color[0]));
+    } else if constexpr (C == 2) {
+        return _mm_set1_epi16(static_cast<short>(color[0] | color[1] << 8));
+    } else {
+        const uint32_t last = B == 4 ? color[3] : 0;
+        return _mm_set1_epi32(static_cast<int>(color[0] | color[1] << 8 | color[2] << 16 |
+                                               last << 24));
+    }
+}
+
+// (fg * a + bg * (256 - a) + 128) >> 8 with a stretched to 0..256
+inline __m128i LerpQ(__m128i fg, __m128i bg, __m128i a)
+{
+    a = _mm_add_epi16(a, _mm_srli_epi16(a, 7));
+    const __m128i inv = _mm_sub_epi16(_mm_set1_epi16(256), a);
+    const __m128i sum = _mm_add_epi16(_mm_mullo_epi16(fg, a), _mm_mullo_epi16(bg, inv));
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(128)), 8);
+}
+
+template <int C, int B, bool Solid>
+void BlendRowQ(uint8_t *row, const uint8_t *background, const uint8_t *alpha, int width,
+               const uint8_t *color)
+{
+    const int bytes = width * C;
+    const __m128i zero = _mm_setzero_si128();
+    __m128i bg = Solid ? LaneColorQ<C, B>(color) : zero;
+    int i = 0;
+
+    for (; i + 16 <= bytes; i += 16) {
+        const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i));
+        const __m128i a = LaneAlphaQ<C, B>(alpha, i);
+        if constexpr (!Solid) {
+            bg = _mm_loadu_si128(reinterpret_cast<const __m128i *>(background + i));
+        }
+
+        const __m128i lo = LerpQ(_mm_cvtepu8_epi16(px), _mm_cvtepu8_epi16(bg),
+                                 _mm_cvtepu8_epi16(a));
+        const __m128i hi = LerpQ(_mm_unpackhi_epi8(px, zero), _mm_unpackhi_epi8(bg, zero),
+                                 _mm_unpackhi_epi8(a, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(row + i), _mm_packus_epi16(lo, hi));
+    }
+
+    const int done = i / C;
+    if constexpr (Solid) {
+        kBlendKernelsScalar.blend_color_q(row + i, alpha + done, width - done, C, B, color);
+    } else {
+        kBlendKernelsScalar.blend_background_q(row + i, background + i, alpha + done,
+                                               width - done, C, B);
+    }
+}
+
+void BlendColorQ(uint8_t *row, const uint8_t *alpha, int width, int channels,
+                 int blend_channels, const uint8_t *color)
+{
+    if (channels == 1) {
+        BlendRowQ<1, 1, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRowQ<2, 2, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 4 && blend_channels == 3) {
+        BlendRowQ<4, 3, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 4 && blend_channels == 4) {
+        BlendRowQ<4, 4, true>(row, nullptr, alpha, width, color);
+    } else {
+        kBlendKernelsScalar.blend_color_q(row, alpha, width, channels, blend_channels, color);
+    }
+}
+
+void BlendBackgroundQ(uint8_t *row, const uint8_t *background, const uint8_t *alpha, int width,
+                      int channels, int blend_channels)
+{
+    if (channels == 1) {
+        BlendRowQ<1, 1, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRowQ<2, 2, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 4 && blend_channels == 3) {
+        BlendRowQ<4, 3, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 4 && blend_channels == 4) {
+        BlendRowQ<4, 4, false>(row, background, alpha, width, nullptr);
+    } else {
+        kBlendKernelsScalar.blend_background_q(row, background, alpha, width, channels,
+                                               blend_channels);
+    }
+}
+
+// 16-bit samples: eight lanes at a time, one or two channels (10-bit
+// luma and interleaved chroma planes)
+
+template <int C>
+inline __m128 LaneColor16(const uint16_t *color)
+{
+    return C == 1 ? _mm_set1_ps(color[0]) : _mm_setr_ps(color[0], color[1], color[0], color[1]);
+}
+
+// Alpha for the four sample lanes starting at `sample`, as int32
+template <int C>
+inline __m128i LaneAlpha16Q(const uint8_t *alpha, int sample)
+{
+    if constexpr (C == 1) {
+        int32_t packed;
+        memcpy(&packed, alpha + sample, sizeof(packed));
+        return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed));
+    } else {
+        uint16_t packed;
+        memcpy(&packed, alpha + sample / 2, sizeof(packed));
+        const __m128i a = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed));
+        return _mm_shuffle_epi32(a, _MM_SHUFFLE(1, 1, 0, 0));
+    }
+}
+
+// LerpQ in 32-bit lanes, where the 16-bit products fit
+inline __m128i LerpQ16(__m128i fg, __m128i bg, __m128i a)
+{
+    a = _mm_add_epi32(a, _mm_srli_epi32(a, 7));
+    const __m128i inv = _mm_sub_epi32(_mm_set1_epi32(256), a);
+    const __m128i sum = _mm_add_epi32(_mm_mullo_epi32(fg, a), _mm_mullo_epi32(bg, inv));
+    return _mm_srli_epi32(_mm_add_epi32(sum, _mm_set1_epi32(128)), 8);
+}
+
+template <int C, bool Solid>
+void BlendRow16(uint16_t *row, const uint16_t *background, const float *alpha, int width,
+                const uint16_t *color)
+{
+    const int samples = width * C;
+    const __m128 color4 = Solid ? LaneColor16<C>(color) : _mm_setzero_ps();
+    int i = 0;
+
+    for (; i + 8 <= samples; i += 8) {
+        const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i));
+        __m128 bg0 = color4, bg1 = color4;
+
+        if constexpr (!Solid) {
+            const __m128i bg =
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(background + i));
+            bg0 = _mm_cvtepi32_ps(_mm_cvtepu16_epi32(bg));
+            bg1 = _mm_cvtepi32_ps(_mm_cvtepu16_epi32(_mm_srli_si128(bg, 8)));
+        }
+
+        const __m128i r0 = Lerp(_mm_cvtepu16_epi32(px), bg0, LaneAlpha<C, C>(alpha, i));
+        const __m128i r1 =
+                Lerp(_mm_cvtepu16_epi32(_mm_srli_si128(px, 8)), bg1, LaneAlpha<C, C>(alpha, i + 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(row + i), _mm_packus_epi32(r0, r1));
+    }
+
+    const int done = i / C;
+    if constexpr (Solid) {
+        kBlendKernelsScalar.blend_color16(row + i, alpha + done, width - done, C, C, color);
+    } else {
+        kBlendKernelsScalar.blend_background16(row + i, background + i, alpha + done,
+                                               width - done, C, C);
+    }
+}
+
+template <int C, bool Solid>
+void BlendRow16Q(uint16_t *row, const uint16_t *background, const uint8_t *alpha, int width,
+                 const uint16_t *color)
+{
+    const int samples = width * C;
+    const __m128i color4 = Solid ? _mm_cvtps_epi32(LaneColor16<C>(color)) : _mm_setzero_si128();
+    int i = 0;
+
+    for (; i + 8 <= samples; i += 8) {
+        const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i));
+        __m128i bg0 = color4, bg1 = color4;
+
+        if constexpr (!Solid) {
+            const __m128i bg =
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(background + i));
+            bg0 = _mm_cvtepu16_epi32(bg);
+            bg1 = _mm_cvtepu16_epi32(_mm_srli_si128(bg, 8));
+        }
+
+        const __m128i r0 = LerpQ16(_mm_cvtepu16_epi32(px), bg0, LaneAlpha16Q<C>(alpha, i));
+        const __m128i r1 = LerpQ16(_mm_cvtepu16_epi32(_mm_srli_si128(px, 8)), bg1,
+                                   LaneAlpha16Q<C>(alpha, i + 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(row + i), _mm_packus_epi32(r0, r1));
+    }
+
+    const int done = i / C;
+    if constexpr (Solid) {
+        kBlendKernelsScalar.blend_color16_q(row + i, alpha + done, width - done, C, C, color);
+    } else {
+        kBlendKernelsScalar.blend_background16_q(row + i, background + i, alpha + done,
+                                                 width - done, C, C);
+    }
+}
+
+void BlendColor16(uint16_t *row, const float *alpha, int width, int channels,
+                  int blend_channels, const uint16_t *color)
+{
+    if (channels == 1) {
+        BlendRow16<1, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRow16<2, true>(row, nullptr, alpha, width, color);
+    } else {
+        kBlendKernelsScalar.blend_color16(row, alpha, width, channels, blend_channels, color);
+    }
+}
+
+void BlendBackground16(uint16_t *row, const uint16_t *background, const float *alpha,
+                       int width, int channels, int blend_channels)
+{
+    if (channels == 1) {
+        BlendRow16<1, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRow16<2, false>(row, background, alpha, width, nullptr);
+    } else {
+        kBlendKernelsScalar.blend_background16(row, background, alpha, width, channels,
+                                               blend_channels);
+    }
+}
+
+void BlendColor16Q(uint16_t *row, const uint8_t *alpha, int width, int channels,
+                   int blend_channels, const uint16_t *color)
+{
+    if (channels == 1) {
+        BlendRow16Q<1, true>(row, nullptr, alpha, width, color);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRow16Q<2, true>(row, nullptr, alpha, width, color);
+    } else {
+        kBlendKernelsScalar.blend_color16_q(row, alpha, width, channels, blend_channels, color);
+    }
+}
+
+void BlendBackground16Q(uint16_t *row, const uint16_t *background, const uint8_t *alpha,
+                        int width, int channels, int blend_channels)
+{
+    if (channels == 1) {
+        BlendRow16Q<1, false>(row, background, alpha, width, nullptr);
+    } else if (channels == 2 && blend_channels == 2) {
+        BlendRow16Q<2, false>(row, background, alpha, width, nullptr);
+    } else {
+        kBlendKernelsScalar.blend_background16_q(row, background, alpha, width, channels,
+                                                 blend_channels);
+    }
+}
+
+void StoreAlpha(uint8_t *dst, const float *alpha, int width, int pixel_stride)
+{
+    int x = 0;
+
+    if (pixel_stride == 1) {
+        const __m128 scale = _mm_set1_ps(255.0f);
+        for (; x + 16 <= width; x += 16) {
+            const __m128i a0 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(alpha + x), scale));
+            const __m128i a1 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(alpha + x + 4), scale));
+            const __m128i a2 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(alpha + x + 8), scale));
+            const __m128i a3 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(alpha + x + 12), scale));
+            const __m128i packed =
+                    _mm_packus_epi16(_mm_packus_epi32(a0, a1), _mm_packus_epi32(a2, a3));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), packed);
+        }
+    }
+
+    kBlendKernelsScalar.store_alpha(dst + x * pixel_stride, alpha + x, width - x, pixel_stride);
+}
+
+} // namespace
+
+const BlendKernels kBlendKernelsSSE41 = {
+    "sse4.1",
+    BlendColor,
+    BlendBackground,
+    BlendColorQ,
+    BlendBackgroundQ,
+    BlendColor16,
+    BlendBackground16,
+    BlendColor16Q,
+    BlendBackground16Q,
+    StoreAlpha,
+};
@@ -0,0 +1,279 @@
+#include "blend-kernels.h"
+#include <obs-module.h>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(BLEND_KERNELS_X86) && defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace {
+
+// Rounded half to even, like cvtps_epi32 under the default rounding mode,
+// so SIMD rows and their scalar tails give the same bytes
+inline uint8_t Mix(int fg, int bg, float alpha)
+{
+    return static_cast<uint8_t>(std::nearbyintf(bg + (fg - bg) * alpha));
+}
+
+void BlendColorScalar(uint8_t *row, const float *alpha, int width, int channels,
+                      int blend_channels, const uint8_t *color)
+{
+    for (int x = 0; x < width; x++) {
+        uint8_t *px = row + x * channels;
+        for (int c = 0; c < blend_channels; c++) {
+            px[c] = Mix(px[c], color[c], alpha[x]);
+        }
+    }
+}
+
+void BlendBackgroundScalar(uint8_t *row, const uint8_t *background, const float *alpha,
+                           int width, int channels, int blend_channels)
+{
+    for (int x = 0; x < width; x++) {
+        uint8_t *px = row + x * channels;
+        const uint8_t *bg = background + x * channels;
+        for (int c = 0; c < blend_channels; c++) {
+            px[c] = Mix(px[c], bg[c], alpha[x]);
+        }
+    }
+}
+
+// alpha 0..255 is stretched to 0..256 so 255 keeps fg exactly; every term
+// stays within 16 bits, which is what lets the SIMD versions use epi16 math
+inline uint8_t MixQ(int fg, int bg, int alpha)
+{
+    const int a = alpha + (alpha >> 7);
+    return static_cast<uint8_t>((fg * a + bg * (256 - a) + 128) >> 8);
+}
+
+void BlendColorScalarQ(uint8_t *row, const uint8_t *alpha, int width, int channels,
+                       int blend_channels, const uint8_t *color)
+{
+    for (int x = 0; x < width; x++) {
+        uint8_t *px = row + x * channels;
+        for (int c = 0; c < blend_channels; c++) {
+            px[c] = MixQ(px[c], color[c], alpha[x]);
+        }
+    }
+}
+
+void BlendBackgroundScalarQ(uint8_t *row, const uint8_t *background, const uint8_t *alpha,
+                            int width, int channels, int blend_channels)
+{
+    for (int x = 0; x < width; x++) {
+        uint8_t *px = row + x * channels;
+        const uint8_t *bg = background + x * channels;
+        for (int c = 0; c < blend_channels; c++) {
+            px[c] = MixQ(px[c], bg[c], alpha[x]);
+        }
+    }
+}
+
+inline uint16_t Mix16(int fg, int bg, float alpha)
+{
+    return static_cast<uint16_t>(std::nearbyintf(bg + (fg - bg) * alpha));
+}
+
+// Same stretch as MixQ; the products need 24 bits here
+inline uint16_t MixQ16(int fg, int bg, int alpha)
+{
+    const int a = alpha + (alpha >> 7);
+    return static_cast<uint16_t>((fg * a + bg * (256 - a) + 128) >> 8);
+}
+
+void BlendColorScalar16(uint16_t *row, const float *alpha, int width, int channels,
+                        int blend_channels, const uint16_t *color)
+{
+    for (int x = 0; x < width; x++) {
+        uint16_t *px = row + x * channels;
+        for (int c = 0; c < blend_channels; c++) {
+            px[c] = Mix16(px[c], color[c], alpha[x]);
+        }
+    }
+}
+
+void BlendBackgroundScalar16(uint16_t *row, const uint16_t *background, const float *alpha,
+                             int width, int channels, int blend_channels)
+{
+    for (int x = 0; x < width; x++) {
+        uint16_t *px = row + x * channels;
+        const uint16_t *bg = background + x * channels;
+        for (int c = 0; c < blend_channels; c++) {
+            px[c] = Mix16(px[c], bg[c], alpha[x]);
+        }
+    }
+}
+
+void BlendColorScalar16Q(uint16_t *row, const uint8_t *alpha, int width, int channels,
+                         int blend_channels, const uint16_t *color)
+{
+    for (int x = 0; x < width; x++) {
+        uint16_t *px = row + x * channels;
+        for (int c = 0; c < blend_channels; c++) {
+            px[c] = MixQ16(px[c], color[c], alpha[x]);
+        }
+    }
+}
+
+void BlendBackgroundScalar16Q(uint16_t *row, const uint16_t *background, const uint8_t *alpha,
+                              int width, int channels, int blend_channels)
+{
+    for (int x = 0; x < width; x++) {
+        uint16_t *px = row + x * channels;
+        const uint16_t *bg = background + x * channels;
+        for (int c = 0; c < blend_channels; c++) {
+            px[c] = MixQ16(px[c], bg[c], alpha[x]);
+        }
+    }
+}
+
+void StoreAlphaScalar(uint8_t *dst, const float *alpha, int width, int pixel_stride)
+{
+    for (int x = 0; x < width; x++) {
+        dst[x * pixel_stride] = static_cast<uint8_t>(std::nearbyintf(alpha[x] * 255.0f));
+    }
+}
+
+#ifdef BLEND_KERNELS_X86
+BlendIsa DetectIsa()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    const int max_leaf = info[0];
+
+    __cpuid(info, 1);
+    const bool sse41 = (info[2] & (1 << 19)) != 0;
+    const bool fma = (info[2] & (1 << 12)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!sse41) {
+        return BlendIsa::Scalar;
+    }
+    if (!osxsave || max_leaf < 7) {
+        return BlendIsa::SSE41;
+    }
+
+    // The OS must save YMM (and for AVX-512, opmask/ZMM) state
+    const unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    const bool avx2 = (info[1] & (1 << 5)) != 0 && fma && (xcr0 & 0x6) == 0x6;
+    const bool avx512 = (info[1] & (1 << 16)) != 0 && (info[1] & (1 << 30)) != 0 &&
+                        (xcr0 & 0xE6) == 0xE6;
+#else
+    __builtin_cpu_init();
+    const bool sse41 = __builtin_cpu_supports("sse4.1");
+    const bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    const bool avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#endif
+
+    if (avx512 && avx2) {
+        return BlendIsa::AVX512;
+    }
+    if (avx2) {
+        return BlendIsa::AVX2;
+    }
+    return sse41 ? BlendIsa::SSE41 : BlendIsa::Scalar;
+}
+#endif
+
+const BlendKernels &TableFor(BlendIsa isa)
+{
+#ifdef BLEND_KERNELS_X86
+    switch (isa) {
+    case BlendIsa::AVX512:
+        return kBlendKernelsAVX512;
+    case BlendIsa::AVX2:
+        return kBlendKernelsAVX2;
+    case BlendIsa::SSE41:
+        return kBlendKernelsSSE41;
+    default:
+        break;
+    }
+#else
+    (void)isa;
+#endif
+    return kBlendKernelsScalar;
+}
+
+std::atomic<const BlendKernels *> active_table{nullptr};
+std::atomic<BlendIsa> active_isa{BlendIsa::Scalar};
+
+} // namespace
+
+const BlendKernels kBlendKernelsScalar = {
+    "scalar",
+    BlendColorScalar,
+    BlendBackgroundScalar,
+    BlendColorScalarQ,
+    BlendBackgroundScalarQ,
+    BlendColorScalar16,
+    BlendBackgroundScalar16,
+    BlendColorScalar16Q,
+    BlendBackgroundScalar16Q,
+    StoreAlphaScalar,
+};
+
+namespace BlendKernelSelect {
+
+void Init()
+{
+    if (active_table.load(std::memory_order_acquire)) {
+        return;
+    }
+
+#ifdef BLEND_KERNELS_X86
+    const BlendIsa detected = DetectIsa();
+#else
+    const BlendIsa detected = BlendIsa::Scalar;
+#endif
+    BlendIsa isa = detected;
+
+    // Allow forcing a lower level for testing; never a higher one
+    if (const char *forced = getenv("BACKGROUND_FILTER_ISA")) {
+        BlendIsa requested = detected;
+        if (strcmp(forced, "scalar") == 0) {
+            requested = BlendIsa::Scalar;
+        } else if (strcmp(forced, "sse41") == 0) {
+            requested = BlendIsa::SSE41;
+        } else if (strcmp(forced, "avx2") == 0) {
+            requested = BlendIsa::AVX2;
+        } else if (strcmp(forced, "avx512") == 0) {
+            requested = BlendIsa::AVX512;
+        } else {
+            blog(LOG_WARNING, "[Background Filter] Unknown BACKGROUND_FILTER_ISA '%s'", forced);
+        }
+
+        if (requested > detected) {
+            blog(LOG_WARNING, "[Background Filter] BACKGROUND_FILTER_ISA=%s not supported by "
+                 "this CPU, using %s", forced, TableFor(detected).name);
+        } else {
+            isa = requested;
+        }
+    }
+
+    active_isa.store(isa, std::memory_order_relaxed);
+    active_table.store(&TableFor(isa), std::memory_order_release);
+    blog(LOG_INFO, "[Background Filter] Blend kernels: %s", TableFor(isa).name);
+}
+
+const BlendKernels &Get()
+{
+    const BlendKernels *table = active_table.load(std::memory_order_acquire);
+    if (!table) {
+        Init();
+        table = active_table.load(std::memory_order_acquire);
+    }
+    return *table;
+}
+
+BlendIsa Active()
+{
+    Get();
+    return active_isa.load(std::memory_order_relaxed);
+}
+
+} // namespace BlendKernelSelect
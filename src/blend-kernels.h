@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+
+// Row kernels used by the compositor. Every ISA level provides the same
+// set; one table is picked at module load from CPUID and can be forced
+// lower with the BACKGROUND_FILTER_ISA environment variable
+// (scalar, sse41, avx2, avx512) to exercise each path on one machine.
+//
+// Rows are interleaved: `channels` samples per pixel, of which the first
+// `blend_channels` are blended and the rest (e.g. RGBA alpha) are left
+// alone. `alpha` holds one value in [0, 1] per pixel, or 0..255 for the
+// fixed-point (_q) variants, which blend with 16-bit multiply-shift math.
+// The 16 variants take rows of 16-bit samples (10-bit formats, whatever
+// their bit alignment) with the same alpha and rounding.
+//
+// Every table gives the same bytes for the same input. Float blends are
+// bg + (fg - bg) * alpha with the multiply and add rounded separately (no
+// FMA contraction; the kernel files are built with it off), then rounded
+// half to even.
+struct BlendKernels {
+    const char *name;
+
+    // row = color + (row - color) * alpha
+    void (*blend_color)(uint8_t *row, const float *alpha, int width, int channels,
+                        int blend_channels, const uint8_t *color);
+
+    // row = background + (row - background) * alpha
+    void (*blend_background)(uint8_t *row, const uint8_t *background, const float *alpha,
+                             int width, int channels, int blend_channels);
+
+    // Fixed-point versions of the two above; alpha 255 keeps the row exactly
+    void (*blend_color_q)(uint8_t *row, const uint8_t *alpha, int width, int channels,
+                          int blend_channels, const uint8_t *color);
+    void (*blend_background_q)(uint8_t *row, const uint8_t *background, const uint8_t *alpha,
+                               int width, int channels, int blend_channels);
+
+    // 16-bit sample versions of the four above
+    void (*blend_color16)(uint16_t *row, const float *alpha, int width, int channels,
+                          int blend_channels, const uint16_t *color);
+    void (*blend_background16)(uint16_t *row, const uint16_t *background, const float *alpha,
+                               int width, int channels, int blend_channels);
+    void (*blend_color16_q)(uint16_t *row, const uint8_t *alpha, int width, int channels,
+                            int blend_channels, const uint16_t *color);
+    void (*blend_background16_q)(uint16_t *row, const uint16_t *background,
+                                 const uint8_t *alpha, int width, int channels,
+                                 int blend_channels);
+
+    // dst[x * pixel_stride] = alpha[x] * 255
+    void (*store_alpha)(uint8_t *dst, const float *alpha, int width, int pixel_stride);
+};
+
+enum class BlendIsa { Scalar, SSE41, AVX2, AVX512 };
+
+namespace BlendKernelSelect {
+
+/**
+ * Detect the CPU, apply any BACKGROUND_FILTER_ISA override and pick the
+ * kernel table. Called from obs_module_load; later calls are no-ops.
+ */
+void Init();
+
+/**
+ * Kernel table chosen by Init() (initializing on first use if needed)
+ * @return Kernels for the active ISA level
+ */
+const BlendKernels &Get();
+
+/**
+ * Active ISA level
+ */
+BlendIsa Active();
+
+} // namespace BlendKernelSelect
+
+// Per-ISA tables; the SIMD ones are only compiled on x86
+extern const BlendKernels kBlendKernelsScalar;
+#ifdef BLEND_KERNELS_X86
+extern const BlendKernels kBlendKernelsSSE41;
+extern const BlendKernels kBlendKernelsAVX2;
+extern const BlendKernels kBlendKernelsAVX512;
+#endif
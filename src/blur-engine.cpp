@@ -0,0 +1,217 @@
+#include "blur-engine.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace BlurEngine {
+
+namespace {
+
+// Below this radius the direct Gaussian is cheaper than any approximation
+constexpr int kDirectRadius = 3;
+
+// Largest downsampling factor of the fast path
+constexpr int kMaxFactor = 8;
+
+// Working set a band may use: a conservative per-core share of L2
+constexpr size_t kBandBytes = 512 * 1024;
+
+// Bands shorter than this spend more time on halo than on output
+constexpr int kMinBandRows = 16;
+
+// Sigma OpenCV derives for a kernel size when sigma is left at 0
+double GaussianSigma(int radius)
+{
+    return 0.3 * (radius - 1) + 0.8;
+}
+
+// Widths of three box filters whose combined variance matches sigma
+// (Kovesi, "Fast almost-Gaussian filtering")
+void BoxWidths(double sigma, int widths[3])
+{
+    const double ideal = std::sqrt(12.0 * sigma * sigma / 3.0 + 1.0);
+    int lower = static_cast<int>(ideal);
+    if (lower % 2 == 0) {
+        lower--;
+    }
+    lower = std::max(lower, 1);
+    const int upper = lower + 2;
+    const int count_lower = std::clamp(static_cast<int>(std::lround(
+            (12.0 * sigma * sigma - 3.0 * lower * lower - 12.0 * lower - 9.0) /
+            (-4.0 * lower - 4.0))), 0, 3);
+
+    for (int i = 0; i < 3; i++) {
+        widths[i] = i < count_lower ? lower : upper;
+    }
+}
+
+// Whether a blur takes the direct Gaussian rather than an approximation
+bool Direct(int radius_x, int radius_y, BlurQuality quality)
+{
+    return quality == BlurQuality::Reference || std::max(radius_x, radius_y) <= kDirectRadius;
+}
+
+uint64_t Bytes(const cv::Mat &image)
+{
+    return static_cast<uint64_t>(image.rows) * image.cols * image.elemSize();
+}
+
+// Run a filter over row stripes of a full (non-ROI) image. Filters on a
+// ROI read their borders from the rows around it, so the stripes add up to
+// exactly what one call over the whole image would produce.
+template <typename Filter>
+void Striped(const cv::Mat &source, cv::Mat &dst, const WorkBudget &budget, Filter filter)
+{
+    budget.ForRows(source.rows, [&](int, int begin, int end) {
+        const cv::Rect rows(0, begin, source.cols, end - begin);
+        cv::Mat out = dst(rows);
+        filter(source(rows), out);
+    });
+}
+
+// cv::blur keeps running sums, so each pass costs the same for any width.
+// `spare` only holds the middle pass and may be `source` itself.
+void StackedBox(const cv::Mat &source, cv::Mat &out, cv::Mat &spare, double sigma_x,
+                double sigma_y, const WorkBudget &budget)
+{
+    int widths_x[3];
+    int widths_y[3];
+    BoxWidths(sigma_x, widths_x);
+    BoxWidths(sigma_y, widths_y);
+
+    auto box = [](cv::Size size) {
+        return [size](const cv::Mat &in, cv::Mat &result) { cv::blur(in, result, size); };
+    };
+    Striped(source, out, budget, box(cv::Size(widths_x[0], widths_y[0])));
+    Striped(out, spare, budget, box(cv::Size(widths_x[1], widths_y[1])));
+    Striped(spare, out, budget, box(cv::Size(widths_x[2], widths_y[2])));
+}
+
+} // namespace
+
+const cv::Mat &Blur(const cv::Mat &source, int plane, int radius_x, int radius_y,
+                    BlurQuality quality, FrameBufferPool &pool, const WorkBudget &budget)
+{
+    const int rows = source.rows;
+    const int cols = source.cols;
+    const int type = source.type();
+    cv::Mat &dst = pool.Plane(plane, FrameBufferPool::kBlurred, rows, cols, type);
+
+    if (Direct(radius_x, radius_y, quality)) {
+        const cv::Size kernel(radius_x * 2 + 1, radius_y * 2 + 1);
+        Striped(source, dst, budget, [kernel](const cv::Mat &in, cv::Mat &result) {
+            cv::GaussianBlur(in, result, kernel, 0);
+        });
+        pool.CountTraffic(Bytes(source), Bytes(dst));
+        return dst;
+    }
+
+    const double sigma_x = GaussianSigma(radius_x);
+    const double sigma_y = GaussianSigma(radius_y);
+
+    // The area downsample and bilinear upsample add roughly factor^2 / 12
+    // and factor^2 / 6 of variance themselves; keeping factor <= sigma / 2
+    // leaves most of it to the box passes
+    auto factor = [quality](double sigma) {
+        return quality == BlurQuality::Fast
+                       ? std::clamp(static_cast<int>(sigma / 2.0), 1, kMaxFactor)
+                       : 1;
+    };
+    const int factor_x = factor(sigma_x);
+    const int factor_y = factor(sigma_y);
+    if (factor_x == 1 && factor_y == 1) {
+        cv::Mat &temp = pool.Plane(plane, FrameBufferPool::kBlurTemp, rows, cols, type);
+        StackedBox(source, dst, temp, sigma_x, sigma_y, budget);
+        pool.CountTraffic(3 * Bytes(source), 3 * Bytes(dst));
+        return dst;
+    }
+
+    const int small_rows = (rows + factor_y - 1) / factor_y;
+    const int small_cols = (cols + factor_x - 1) / factor_x;
+    cv::Mat &small = pool.Plane(plane, FrameBufferPool::kBlurSmall, small_rows, small_cols, type);
+    cv::Mat &small_blurred =
+            pool.Plane(plane, FrameBufferPool::kBlurSmallTemp, small_rows, small_cols, type);
+
+    // An axis left at full size is not resampled and keeps its whole sigma
+    auto residual = [](double sigma, int factor) {
+        return factor == 1 ? sigma : std::sqrt(sigma * sigma - factor * factor / 4.0) / factor;
+    };
+    cv::resize(source, small, small.size(), 0, 0, cv::INTER_AREA);
+    StackedBox(small, small_blurred, small, residual(sigma_x, factor_x),
+               residual(sigma_y, factor_y), budget);
+    cv::resize(small_blurred, dst, dst.size(), 0, 0, cv::INTER_LINEAR);
+    pool.CountTraffic(Bytes(source) + 4 * Bytes(small), 4 * Bytes(small) + Bytes(dst));
+    return dst;
+}
+
+bool SupportsBands(int radius_x, int radius_y, BlurQuality quality)
+{
+    return quality != BlurQuality::Fast || Direct(radius_x, radius_y, quality);
+}
+
+int BandHalo(int radius_x, int radius_y, BlurQuality quality)
+{
+    // Only the vertical kernel reaches across rows
+    if (Direct(radius_x, radius_y, quality)) {
+        return radius_y;
+    }
+
+    int widths[3];
+    BoxWidths(GaussianSigma(radius_y), widths);
+    return (widths[0] + widths[1] + widths[2] - 3) / 2;
+}
+
+int BandRows(const cv::Mat &source, int radius_x, int radius_y, BlurQuality quality)
+{
+    const int halo = BandHalo(radius_x, radius_y, quality);
+
+    // The frame rows, the band's input copy and two pass buffers
+    const size_t row_bytes = static_cast<size_t>(source.cols) * source.elemSize();
+    const int fit = static_cast<int>(kBandBytes / std::max<size_t>(row_bytes * 4, 1));
+    return std::max({fit - 2 * halo, 2 * halo, kMinBandRows});
+}
+
+cv::Mat BlurBand(const cv::Mat &input, int plane, int offset, int rows, int radius_x,
+                 int radius_y, BlurQuality quality, FrameBufferPool &pool, int stripe)
+{
+    const int cols = input.cols;
+    const int type = input.type();
+
+    // Every pass treats its buffer as a whole image (BORDER_ISOLATED). Rows
+    // within a kernel's reach of a cut come out wrong, but the halo keeps
+    // them out of the band; at a plane edge the reflection is the same one
+    // the full-plane blur applies.
+    const int border = cv::BORDER_REFLECT_101 | cv::BORDER_ISOLATED;
+    const cv::Rect band(0, offset, cols, rows);
+    cv::Mat first = pool.Band(stripe, plane, FrameBufferPool::kBandPass, input.rows, cols, type);
+
+    if (Direct(radius_x, radius_y, quality)) {
+        const cv::Size kernel(radius_x * 2 + 1, radius_y * 2 + 1);
+        cv::GaussianBlur(input, first, kernel, 0, 0, border);
+        return first(band);
+    }
+
+    int widths_x[3];
+    int widths_y[3];
+    BoxWidths(GaussianSigma(radius_x), widths_x);
+    BoxWidths(GaussianSigma(radius_y), widths_y);
+    cv::Mat second =
+            pool.Band(stripe, plane, FrameBufferPool::kBandPassTemp, input.rows, cols, type);
+    cv::blur(input, first, cv::Size(widths_x[0], widths_y[0]), cv::Point(-1, -1), border);
+    cv::blur(first, second, cv::Size(widths_x[1], widths_y[1]), cv::Point(-1, -1), border);
+    cv::blur(second, first, cv::Size(widths_x[2], widths_y[2]), cv::Point(-1, -1), border);
+    return first(band);
+}
+
+BlurQuality QualityFromString(const char *name)
+{
+    if (name && strcmp(name, "fast") == 0) {
+        return BlurQuality::Fast;
+    }
+    if (name && strcmp(name, "reference") == 0) {
+        return BlurQuality::Reference;
+    }
+    return BlurQuality::Balanced;
+}
+
+} // namespace BlurEngine
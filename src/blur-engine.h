@@ -0,0 +1,89 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include "frame-buffer-pool.h"
+#include "thread-pool.h"
+
+// How the background blur is computed. Fast and Balanced cost the same
+// whatever the radius; Reference is the direct Gaussian the blur_amount
+// setting was originally tuned against.
+enum class BlurQuality {
+    Fast,       // Area downsample, box blurs, bilinear upsample
+    Balanced,   // Three stacked box blurs at full resolution
+    Reference,  // cv::GaussianBlur
+};
+
+namespace BlurEngine {
+
+/**
+ * Blur one plane with a Gaussian-equivalent kernel of the given radii
+ * @param source Plane to blur (interleaved, 8-bit)
+ * @param plane Plane index, used to pick the pool's scratch images
+ * @param radius_x Horizontal radius in plane pixels
+ * @param radius_y Vertical radius in plane pixels; the pair matches
+ *        GaussianBlur(Size(2 * radius_x + 1, 2 * radius_y + 1))
+ * @param quality Approximation to use
+ * @param pool Scratch buffers
+ * @param budget Threads the filter passes may use, in row stripes
+ * @return Blurred plane, owned by the pool
+ */
+const cv::Mat &Blur(const cv::Mat &source, int plane, int radius_x, int radius_y,
+                    BlurQuality quality, FrameBufferPool &pool, const WorkBudget &budget);
+
+/**
+ * Whether BlurBand() can produce this blur. The fast path resamples the
+ * whole plane and has no band form.
+ * @param radius_x Horizontal radius in plane pixels
+ * @param radius_y Vertical radius in plane pixels
+ * @param quality Approximation to use
+ * @return true if the plane can be blurred band by band
+ */
+bool SupportsBands(int radius_x, int radius_y, BlurQuality quality);
+
+/**
+ * Rows a band needs on each side: the reach of the whole filter chain
+ * @param radius_x Horizontal radius in plane pixels
+ * @param radius_y Vertical radius in plane pixels
+ * @param quality Approximation to use
+ * @return Halo rows above and below
+ */
+int BandHalo(int radius_x, int radius_y, BlurQuality quality);
+
+/**
+ * Band height for the fused blur/blend path: as many rows as keep a band,
+ * its halo and the band buffers within a per-core share of L2, but never
+ * so few that recomputing the halo dominates
+ * @param source Plane to blur
+ * @param radius_x Horizontal radius in plane pixels
+ * @param radius_y Vertical radius in plane pixels
+ * @param quality Approximation to use
+ * @return Rows per band, at least twice BandHalo()
+ */
+int BandRows(const cv::Mat &source, int radius_x, int radius_y, BlurQuality quality);
+
+/**
+ * Blur one band of a plane from a tile-local copy of its rows. Each edge
+ * of `input` must either be a plane edge or lie BandHalo() rows beyond the
+ * band; the result is then identical to the same rows of Blur().
+ * @param input Copy of plane rows, the band plus its halo
+ * @param plane Plane index, selecting the band buffers
+ * @param offset Row of `input` holding the first band row
+ * @param rows Band height
+ * @param radius_x Horizontal radius in plane pixels
+ * @param radius_y Vertical radius in plane pixels
+ * @param quality Approximation to use; SupportsBands() must allow it
+ * @param pool Scratch buffers
+ * @param stripe Stripe the calling thread is running
+ * @return Blurred band in the stripe's buffers, valid until its next call
+ */
+cv::Mat BlurBand(const cv::Mat &input, int plane, int offset, int rows, int radius_x,
+                 int radius_y, BlurQuality quality, FrameBufferPool &pool, int stripe);
+
+/**
+ * Parse a quality setting
+ * @param name "fast", "balanced" or "reference"
+ * @return Matching quality, Balanced for anything else
+ */
+BlurQuality QualityFromString(const char *name);
+
+} // namespace BlurEngine
@@ -0,0 +1,77 @@
+#include "filter-stats.h"
+#include <util/platform.h>
+
+FilterStats::FilterStats()
+    : frame_start_(0), window_start_(0), frames_(0), busy_ns_(0), bytes_read_(0),
+      bytes_written_(0), gated_frames_(0), inference_skips_(0), background_reuses_(0),
+      window_outcomes_{}, outcomes_{}
+{
+}
+
+void FilterStats::BeginFrame()
+{
+    frame_start_ = os_gettime_ns();
+    if (window_start_ == 0) {
+        window_start_ = frame_start_;
+    }
+}
+
+uint64_t FilterStats::EndFrame(const struct obs_source_frame *frame, const MemoryTraffic &traffic,
+                               bool tiled, FrameOutcome outcome)
+{
+    const uint64_t now = os_gettime_ns();
+    const uint64_t elapsed = now - frame_start_;
+
+    frames_++;
+    busy_ns_ += elapsed;
+    bytes_read_ += traffic.read;
+    bytes_written_ += traffic.written;
+    window_outcomes_[static_cast<int>(outcome)]++;
+    outcomes_[static_cast<int>(outcome)].fetch_add(1, std::memory_order_relaxed);
+
+    if (now - window_start_ >= kWindowNs) {
+        const double frames = static_cast<double>(frames_);
+        blog(LOG_INFO, "[Background Filter] %ux%u: %.2f ms/frame, %.1f MB read + %.1f MB "
+             "written per frame (%s, %llu frames)", frame->width, frame->height,
+             busy_ns_ / frames / 1e6, bytes_read_ / frames / 1e6, bytes_written_ / frames / 1e6,
+             tiled ? "tiled" : "whole-plane", static_cast<unsigned long long>(frames_));
+        blog(LOG_INFO, "[Background Filter] Frames: %llu composited, %llu reused mask, "
+             "%llu passed through, %llu held",
+             static_cast<unsigned long long>(window_outcomes_[0]),
+             static_cast<unsigned long long>(window_outcomes_[1]),
+             static_cast<unsigned long long>(window_outcomes_[2]),
+             static_cast<unsigned long long>(window_outcomes_[3]));
+        if (gated_frames_ > 0) {
+            const double gated = static_cast<double>(gated_frames_);
+            blog(LOG_INFO, "[Background Filter] Static gate: %.1f%% of frames skipped "
+                 "inference, %.1f%% reused the blurred background",
+                 100.0 * inference_skips_ / gated, 100.0 * background_reuses_ / gated);
+        }
+
+        window_start_ = now;
+        frames_ = 0;
+        busy_ns_ = 0;
+        bytes_read_ = 0;
+        bytes_written_ = 0;
+        gated_frames_ = 0;
+        inference_skips_ = 0;
+        background_reuses_ = 0;
+        for (uint64_t &count : window_outcomes_) {
+            count = 0;
+        }
+    }
+
+    return elapsed;
+}
+
+void FilterStats::CountGate(bool inference_skipped, bool background_reused)
+{
+    gated_frames_++;
+    inference_skips_ += inference_skipped ? 1 : 0;
+    background_reuses_ += background_reused ? 1 : 0;
+}
+
+uint64_t FilterStats::GetOutcomeCount(FrameOutcome outcome) const
+{
+    return outcomes_[static_cast<int>(outcome)].load(std::memory_order_relaxed);
+}
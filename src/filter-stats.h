@@ -0,0 +1,72 @@
+#pragma once
+
+#include <obs-module.h>
+#include <atomic>
+#include <cstdint>
+#include "frame-buffer-pool.h"
+
+// What filter_video did with a frame
+enum class FrameOutcome {
+    Composited,     // Blended with an up-to-date mask
+    ReusedMask,     // Overloaded; blended with the last mask anyway
+    PassedThrough,  // Overloaded or no mask yet; left untouched
+    HeldFrame,      // Overloaded; replaced by the last composited frame
+    kCount
+};
+
+// Per-filter frame timing, memory traffic, frame outcomes and static-scene
+// gating. Totals are kept over a window of frames and written to the OBS
+// log once the window closes, so the cost of a setting can be read off a
+// running stream.
+class FilterStats {
+public:
+    // Nanoseconds between log lines (30 s)
+    static constexpr uint64_t kWindowNs = 30000000000ULL;
+
+    FilterStats();
+
+    /**
+     * Mark the start of a frame's processing
+     */
+    void BeginFrame();
+
+    /**
+     * Account for a processed frame and log the window if it has closed
+     * @param frame Frame that was processed
+     * @param traffic Bytes moved to and from frame-sized memory for it
+     * @param tiled Whether the fused band path was in use
+     * @param outcome What was done with the frame
+     * @return Processing time of this frame in nanoseconds
+     */
+    uint64_t EndFrame(const struct obs_source_frame *frame, const MemoryTraffic &traffic,
+                      bool tiled, FrameOutcome outcome);
+
+    /**
+     * Frames with an outcome since the filter was created; safe to call
+     * from any thread
+     * @param outcome Outcome to count
+     * @return Number of frames
+     */
+    uint64_t GetOutcomeCount(FrameOutcome outcome) const;
+
+    /**
+     * Record what the static-scene gate did for a frame; call before
+     * EndFrame() and only while the gate is enabled
+     * @param inference_skipped The frame was due for inference but static
+     * @param background_reused The previous blurred background was reused
+     */
+    void CountGate(bool inference_skipped, bool background_reused);
+
+private:
+    uint64_t frame_start_;
+    uint64_t window_start_;
+    uint64_t frames_;
+    uint64_t busy_ns_;
+    uint64_t bytes_read_;
+    uint64_t bytes_written_;
+    uint64_t gated_frames_;
+    uint64_t inference_skips_;
+    uint64_t background_reuses_;
+    uint64_t window_outcomes_[static_cast<int>(FrameOutcome::kCount)];
+    std::atomic<uint64_t> outcomes_[static_cast<int>(FrameOutcome::kCount)];
+};
@@ -0,0 +1,92 @@
+#include "frame-buffer-pool.h"
+
+FrameBufferPool::FrameBufferPool()
+    : width_(0), height_(0), format_(VIDEO_FORMAT_NONE), allocation_count_(0)
+{
+}
+
+bool FrameBufferPool::Configure(const struct obs_source_frame *frame)
+{
+    if (frame->width == width_ && frame->height == height_ && frame->format == format_) {
+        return false;
+    }
+
+    width_ = frame->width;
+    height_ = frame->height;
+    format_ = frame->format;
+
+    // Plane scratch is re-created lazily at its new shape
+    for (auto &plane : planes_) {
+        for (cv::Mat &scratch : plane) {
+            scratch.release();
+        }
+    }
+
+    // Chroma planes are never wider than luma, and packed 4:2:2 rows take
+    // four bytes per two pixels. Sized eagerly for every stripe so nothing
+    // is allocated from the pool's threads.
+    for (StripeScratch &stripe : stripes_) {
+        stripe.alpha.Resize(width_);
+        stripe.alpha_q.Resize(width_);
+        stripe.packed.Resize(2 * static_cast<size_t>(width_) + 2);
+        for (auto &plane : stripe.band) {
+            for (cv::Mat &band : plane) {
+                band.release();
+            }
+        }
+        allocation_count_ += 3;
+    }
+
+    return true;
+}
+
+cv::Mat &FrameBufferPool::Plane(int index, Scratch kind, int rows, int cols, int type)
+{
+    cv::Mat &plane = planes_[index][kind];
+
+    if (plane.rows != rows || plane.cols != cols || plane.type() != type) {
+        plane.create(rows, cols, type);
+        allocation_count_++;
+    }
+
+    return plane;
+}
+
+bool FrameBufferPool::HasPlane(int index, Scratch kind, int rows, int cols, int type) const
+{
+    const cv::Mat &plane = planes_[index][kind];
+    return !plane.empty() && plane.rows == rows && plane.cols == cols && plane.type() == type;
+}
+
+cv::Mat FrameBufferPool::Band(int stripe, int plane, BandBuffer kind, int rows, int cols,
+                              int type)
+{
+    cv::Mat &band = stripes_[stripe].band[plane][kind];
+
+    if (band.rows < rows || band.cols != cols || band.type() != type) {
+        band.create(rows, cols, type);
+        allocation_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return band(cv::Rect(0, 0, cols, rows));
+}
+
+void FrameBufferPool::CountTraffic(uint64_t read, uint64_t written)
+{
+    traffic_.read += read;
+    traffic_.written += written;
+}
+
+MemoryTraffic FrameBufferPool::TakeTraffic()
+{
+    MemoryTraffic total = traffic_;
+    traffic_ = MemoryTraffic();
+
+    for (StripeScratch &stripe : stripes_) {
+        total.read += stripe.traffic.read;
+        total.written += stripe.traffic.written;
+        stripe.traffic = MemoryTraffic();
+    }
+
+    return total;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <obs-module.h>
+#include <atomic>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include "aligned-buffer.h"
+#include "mask-view.h"
+#include "thread-pool.h"
+
+// Bytes moved to and from frame-sized memory (frame planes and full-plane
+// scratch). Small tile-local buffers that stay in cache are not counted.
+struct MemoryTraffic {
+    uint64_t read = 0;
+    uint64_t written = 0;
+};
+
+// Frame-sized scratch owned by one filter instance. Everything is sized
+// for the current frame layout and kept across frames; buffers are only
+// dropped when the frame dimensions or format change, so steady-state
+// frames allocate nothing.
+class FrameBufferPool {
+public:
+    static constexpr int kMaxPlanes = 3;
+
+    // Per-plane scratch images
+    enum Scratch {
+        kBlurred,       // Blurred copy of the plane
+        kBlurSmall,     // Downsampled plane for the fast blur
+        kBlurSmallTemp, // Box blur output at the downsampled size
+        kBlurTemp,      // Intermediate box blur pass
+        kHeld,          // Last composited frame, for the hold-frame policy
+        kAlpha,         // Alpha plane lent to planar frames (plane 0 only)
+        kHeldAlpha,     // Alpha of the held frame (plane 0 only)
+        kNeutralChroma, // Chroma lent to Y800 frames given alpha (plane 1 only)
+        kScratchCount
+    };
+
+    // Per-stripe tile-local buffers of the fused blur/blend path
+    enum BandBuffer {
+        kBandInput,         // Original rows of the current band and its halo
+        kBandInputPrev,     // The same for the previous band
+        kBandPass,          // Blur pass output
+        kBandPassTemp,      // Middle box blur pass
+        kBandSeamAbove,     // Original rows above the stripe
+        kBandSeamBelow,     // Original rows below the stripe
+        kBandCount
+    };
+
+    FrameBufferPool();
+
+    /**
+     * Adopt the layout of an incoming frame
+     * @param frame Frame about to be processed
+     * @return true if the layout changed and buffers were released
+     */
+    bool Configure(const struct obs_source_frame *frame);
+
+    /**
+     * Scratch image for one plane
+     * @param index Plane index, below kMaxPlanes
+     * @param kind Which of the plane's scratch images
+     * @param rows Plane height
+     * @param cols Plane width
+     * @param type OpenCV type
+     * @return Buffer of that shape; reused while the shape is unchanged
+     */
+    cv::Mat &Plane(int index, Scratch kind, int rows, int cols, int type);
+
+    /**
+     * Whether a plane's scratch image exists at the given shape, without
+     * creating it
+     * @return true if Plane() with the same arguments would not allocate
+     */
+    bool HasPlane(int index, Scratch kind, int rows, int cols, int type) const;
+
+    // Working memory for one row stripe; each stripe is used by one thread
+    // at a time, so stripes never share anything
+    struct StripeScratch {
+        AlignedBuffer<float> alpha;         // One row, wide enough for any plane
+        AlignedBuffer<uint8_t> alpha_q;
+        AlignedBuffer<uint8_t> packed;      // One frame row, while repacking it in place
+        MaskView::RowScratch mask;
+        cv::Mat band[kMaxPlanes][kBandCount]; // Tile-local buffers, see Band()
+        MemoryTraffic traffic;
+    };
+
+    StripeScratch &Stripe(int index) { return stripes_[index]; }
+
+    /**
+     * Tile-local buffer of a stripe, grown on demand and kept at its
+     * largest size; called from the stripe's own thread. Each plane has its
+     * own set, since planes differ in width and type.
+     * @param stripe Stripe index
+     * @param plane Plane index, below kMaxPlanes
+     * @param kind Which of the stripe's band buffers
+     * @param rows Rows needed
+     * @param cols Plane width
+     * @param type OpenCV type
+     * @return The first `rows` rows of the buffer
+     */
+    cv::Mat Band(int stripe, int plane, BandBuffer kind, int rows, int cols, int type);
+
+    /**
+     * Record traffic from the calling (video) thread
+     */
+    void CountTraffic(uint64_t read, uint64_t written);
+
+    /**
+     * Collect and reset the traffic counted since the last call, including
+     * every stripe's; only call while no stripes are running
+     * @return Bytes read and written
+     */
+    MemoryTraffic TakeTraffic();
+
+    // Number of buffer (re)allocations so far, for spotting churn
+    uint64_t GetAllocationCount() const
+    {
+        return allocation_count_.load(std::memory_order_relaxed);
+    }
+
+private:
+    uint32_t width_;
+    uint32_t height_;
+    enum video_format format_;
+
+    cv::Mat planes_[kMaxPlanes][kScratchCount];
+    StripeScratch stripes_[ThreadPool::kMaxStripes];
+    MemoryTraffic traffic_;
+
+    std::atomic<uint64_t> allocation_count_;
+};
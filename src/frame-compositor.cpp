@@ -0,0 +1,765 @@
+#include "frame-compositor.h"
+#include "blend-kernels.h"
+#include "blur-engine.h"
+#include "frame-view.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Compositor {
+
+namespace {
+
+// OpenCV type of a plane; 10-bit samples stay in their 16-bit words
+int PlaneType(const PlaneView &plane)
+{
+    return plane.sample_size == 2 ? CV_16UC(plane.channels) : CV_8UC(plane.channels);
+}
+
+// Background for pixels [0, width) of a row: a solid colour or a copy of
+// the background row. Channels that are not blended are left alone.
+template <typename Sample>
+void FillSpan(const PlaneView &plane, Sample *row, const Sample *background,
+              const Sample *color, int width)
+{
+    const int channels = plane.channels;
+
+    if (background && plane.blend_channels == channels) {
+        std::memcpy(row, background, static_cast<size_t>(width) * channels * sizeof(Sample));
+        return;
+    }
+    if (!background && channels == 1) {
+        std::fill(row, row + width, color[0]);
+        return;
+    }
+
+    for (int x = 0; x < width; x++) {
+        for (int c = 0; c < plane.blend_channels; c++) {
+            row[x * channels + c] = background ? background[x * channels + c] : color[c];
+        }
+    }
+}
+
+void BlendSpan(const BlendKernels &kernels, const PlaneView &plane, uint8_t *row,
+               const uint8_t *background, const uint8_t *color, const float *alpha, int width)
+{
+    if (background) {
+        kernels.blend_background(row, background, alpha, width, plane.channels,
+                                 plane.blend_channels);
+    } else {
+        kernels.blend_color(row, alpha, width, plane.channels, plane.blend_channels, color);
+    }
+}
+
+void BlendSpan(const BlendKernels &kernels, const PlaneView &plane, uint8_t *row,
+               const uint8_t *background, const uint8_t *color, const uint8_t *alpha, int width)
+{
+    if (background) {
+        kernels.blend_background_q(row, background, alpha, width, plane.channels,
+                                   plane.blend_channels);
+    } else {
+        kernels.blend_color_q(row, alpha, width, plane.channels, plane.blend_channels, color);
+    }
+}
+
+void BlendSpan(const BlendKernels &kernels, const PlaneView &plane, uint16_t *row,
+               const uint16_t *background, const uint16_t *color, const float *alpha,
+               int width)
+{
+    if (background) {
+        kernels.blend_background16(row, background, alpha, width, plane.channels,
+                                   plane.blend_channels);
+    } else {
+        kernels.blend_color16(row, alpha, width, plane.channels, plane.blend_channels, color);
+    }
+}
+
+void BlendSpan(const BlendKernels &kernels, const PlaneView &plane, uint16_t *row,
+               const uint16_t *background, const uint16_t *color, const uint8_t *alpha,
+               int width)
+{
+    if (background) {
+        kernels.blend_background16_q(row, background, alpha, width, plane.channels,
+                                     plane.blend_channels);
+    } else {
+        kernels.blend_color16_q(row, alpha, width, plane.channels, plane.blend_channels,
+                                color);
+    }
+}
+
+// Background rows for BlendRows: a whole blurred plane, or one band of it
+// still in cache from BlurBand(). Null for a solid colour.
+struct BackgroundRows {
+    cv::Mat image;
+    int first_row = 0;      // Plane row held in image row 0
+    bool cached = false;    // Band and frame rows were just loaded into cache
+};
+
+// Blend one plane in place towards either a solid colour or a background
+// plane. Each row is split into runs at mask resolution: background runs
+// are filled, foreground runs are skipped, and only the transition band is
+// blended with alpha interpolated for just those pixels. Fixed-point masks
+// stay 8-bit all the way through the integer kernels. Rows are independent,
+// so stripes of them run on the thread pool.
+template <typename Sample, typename Alpha>
+void BlendRows(const PlaneView &plane, const MaskView &mask, const Sample *color,
+               const BackgroundRows &background, Alpha *alpha, MaskView::RowScratch &scratch,
+               MemoryTraffic &traffic, int begin, int end)
+{
+    const BlendKernels &kernels = BlendKernelSelect::Get();
+    const int channels = plane.channels;
+    const bool has_background = !background.image.empty();
+    const uint64_t row_cost = background.cached ? 0 : 1;
+    const uint64_t background_cost = has_background && !background.cached ? 1 : 0;
+
+    for (int y = begin; y < end; y++) {
+        Sample *row = reinterpret_cast<Sample *>(plane.Row(y));
+        const Sample *bg_row =
+                has_background ? background.image.ptr<Sample>(y - background.first_row)
+                               : nullptr;
+
+        for (const AlphaSpan &span :
+             mask.SampleSpans(plane.width, plane.height, y, alpha, scratch)) {
+            const int offset = span.begin * channels;
+            const int width = span.end - span.begin;
+            const uint64_t bytes = static_cast<uint64_t>(width) * channels * sizeof(Sample);
+            const Sample *bg = bg_row ? bg_row + offset : nullptr;
+
+            switch (span.kind) {
+            case AlphaSpan::kForeground:
+                break;
+            case AlphaSpan::kBackground:
+                FillSpan(plane, row + offset, bg, color, width);
+                traffic.read += bytes * background_cost;
+                traffic.written += bytes;
+                break;
+            case AlphaSpan::kPartial:
+                BlendSpan(kernels, plane, row + offset, bg, color, alpha + span.begin, width);
+                traffic.read += bytes * (row_cost + background_cost);
+                traffic.written += bytes;
+                break;
+            }
+        }
+    }
+}
+
+template <typename Sample>
+void BlendRows(const PlaneView &plane, const MaskView &mask, const Sample *color,
+               const BackgroundRows &background, FrameBufferPool::StripeScratch &scratch,
+               int begin, int end)
+{
+    if (mask.FixedPoint()) {
+        BlendRows(plane, mask, color, background, scratch.alpha_q.data(), scratch.mask,
+                  scratch.traffic, begin, end);
+    } else {
+        BlendRows(plane, mask, color, background, scratch.alpha.data(), scratch.mask,
+                  scratch.traffic, begin, end);
+    }
+}
+
+// Picks the sample type; `color` is one pixel of the plane (see PlaneColor)
+void BlendStripe(const PlaneView &plane, const MaskView &mask, const uint16_t *color,
+                 const BackgroundRows &background, FrameBufferPool::StripeScratch &scratch,
+                 int begin, int end)
+{
+    if (plane.sample_size == 2) {
+        BlendRows(plane, mask, color, background, scratch, begin, end);
+        return;
+    }
+
+    uint8_t narrow[4] = {};
+    if (color) {
+        std::copy(color, color + plane.blend_channels, narrow);
+    }
+    BlendRows(plane, mask, color ? narrow : nullptr, background, scratch, begin, end);
+}
+
+// The colour triple laid out as one pixel of a plane
+void PlaneColor(const PlaneView &plane, const uint16_t color[3], uint16_t pixel[4])
+{
+    for (int c = 0; c < plane.blend_channels; c++) {
+        pixel[c] = color[plane.color_channel[c]];
+    }
+}
+
+void BlendPlane(const PlaneView &plane, MaskView &mask, const uint16_t *color,
+                const BackgroundRows &background, FrameBufferPool &pool, const WorkBudget &budget)
+{
+    mask.Prepare(plane.width);
+
+    budget.ForRows(plane.height, [&](int stripe, int begin, int end) {
+        BlendStripe(plane, mask, color, background, pool.Stripe(stripe), begin, end);
+    });
+}
+
+// Fused blur and blend: each stripe walks its rows in L2-sized bands,
+// copying a band and its halo into a tile-local buffer, blurring that and
+// blending the band into the frame straight away. The blurred plane never
+// goes out to memory and each frame row is loaded once.
+//
+// Blending in place destroys rows that later halos still need, so every
+// halo row comes from wherever its original pixels survive: the previous
+// band's input copy within a stripe, or a copy of the rows around the
+// stripe taken before any stripe starts writing.
+void BlurBlendBands(const PlaneView &plane, int index, MaskView &mask, int radius_x,
+                    int radius_y, BlurQuality quality, FrameBufferPool &pool,
+                    const WorkBudget &budget)
+{
+    const int rows = plane.height;
+    const int cols = plane.width;
+    const int type = PlaneType(plane);
+    const size_t row_bytes = static_cast<size_t>(cols) * plane.channels * plane.sample_size;
+    const cv::Mat source(rows, cols, type, plane.data, plane.stride);
+    const int halo = BlurEngine::BandHalo(radius_x, radius_y, quality);
+    const int band_rows = BlurEngine::BandRows(source, radius_x, radius_y, quality);
+
+    mask.Prepare(cols);
+
+    // ForRows splits the same row count the same way both times
+    budget.ForRows(rows, [&](int stripe, int begin, int end) {
+        const int above = std::max(begin - halo, 0);
+        const int below = std::min(end + halo, rows);
+        if (begin > above) {
+            cv::Mat seam = pool.Band(stripe, index, FrameBufferPool::kBandSeamAbove,
+                                     begin - above, cols, type);
+            source(cv::Rect(0, above, cols, begin - above)).copyTo(seam);
+        }
+        if (below > end) {
+            cv::Mat seam = pool.Band(stripe, index, FrameBufferPool::kBandSeamBelow,
+                                     below - end, cols, type);
+            source(cv::Rect(0, end, cols, below - end)).copyTo(seam);
+        }
+        pool.Stripe(stripe).traffic.read += row_bytes * ((begin - above) + (below - end));
+    });
+
+    budget.ForRows(rows, [&](int stripe, int begin, int end) {
+        FrameBufferPool::StripeScratch &scratch = pool.Stripe(stripe);
+        cv::Mat *bands = scratch.band[index];
+        const cv::Mat &seam_above = bands[FrameBufferPool::kBandSeamAbove];
+        const cv::Mat &seam_below = bands[FrameBufferPool::kBandSeamBelow];
+        const int above = std::max(begin - halo, 0);
+        int previous_first = 0;
+
+        for (int band = begin; band < end; band += band_rows) {
+            const int band_end = std::min(band + band_rows, end);
+            const int first = std::max(band - halo, 0);
+            const int last = std::min(band_end + halo, rows);
+
+            std::swap(bands[FrameBufferPool::kBandInput], bands[FrameBufferPool::kBandInputPrev]);
+            const cv::Mat &previous = bands[FrameBufferPool::kBandInputPrev];
+            cv::Mat input = pool.Band(stripe, index, FrameBufferPool::kBandInput, last - first,
+                                      cols, type);
+
+            for (int y = first; y < last; y++) {
+                const uint8_t *original;
+                if (y < begin) {
+                    original = seam_above.ptr<uint8_t>(y - above);
+                } else if (y >= end) {
+                    original = seam_below.ptr<uint8_t>(y - end);
+                } else if (y < band) {
+                    original = previous.ptr<uint8_t>(y - previous_first);
+                } else {
+                    original = plane.Row(y);
+                    scratch.traffic.read += row_bytes;
+                }
+                std::memcpy(input.ptr<uint8_t>(y - first), original, row_bytes);
+            }
+            previous_first = first;
+
+            BackgroundRows background;
+            background.image = BlurEngine::BlurBand(input, index, band - first, band_end - band,
+                                                    radius_x, radius_y, quality, pool, stripe);
+            background.first_row = band;
+            background.cached = true;
+            BlendStripe(plane, mask, nullptr, background, scratch, band, band_end);
+        }
+    });
+}
+
+// Format a frame takes once it carries alpha, or VIDEO_FORMAT_NONE when
+// it has no variant with an alpha channel or plane. NV12, packed 4:2:2 and
+// Y800 become planar first (see PlanarLayout).
+enum video_format AlphaFormat(enum video_format format)
+{
+    switch (format) {
+    case VIDEO_FORMAT_I420:
+    case VIDEO_FORMAT_I40A:
+    case VIDEO_FORMAT_NV12:
+    case VIDEO_FORMAT_Y800:
+        return VIDEO_FORMAT_I40A;
+    case VIDEO_FORMAT_I422:
+    case VIDEO_FORMAT_I42A:
+    case VIDEO_FORMAT_YUY2:
+    case VIDEO_FORMAT_UYVY:
+        return VIDEO_FORMAT_I42A;
+    case VIDEO_FORMAT_I444:
+    case VIDEO_FORMAT_YUVA:
+        return VIDEO_FORMAT_YUVA;
+    case VIDEO_FORMAT_RGBA:
+        return VIDEO_FORMAT_RGBA;
+    case VIDEO_FORMAT_BGRA:
+    case VIDEO_FORMAT_BGRX:
+        return VIDEO_FORMAT_BGRA;
+    default:
+        return VIDEO_FORMAT_NONE;
+    }
+}
+
+bool PackedAlpha(enum video_format format)
+{
+    return format == VIDEO_FORMAT_RGBA || format == VIDEO_FORMAT_BGRA;
+}
+
+// The frame already has alpha of its own
+bool CarriesAlpha(const struct obs_source_frame *frame)
+{
+    return AlphaFormat(frame->format) == frame->format &&
+           (PackedAlpha(frame->format) || frame->data[3]);
+}
+
+// Alpha of a frame that carries it: the A byte of each RGBA/BGRA pixel,
+// one sample every four bytes, or the fourth plane
+PlaneView AlphaPlane(const struct obs_source_frame *frame)
+{
+    const int width = static_cast<int>(frame->width);
+    const int height = static_cast<int>(frame->height);
+
+    if (PackedAlpha(frame->format)) {
+        return {frame->data[0] + 3, frame->linesize[0], width, height, 1, 1, 4, 1, 1, {0}};
+    }
+    return {frame->data[3], frame->linesize[3], width, height, 1, 1, 1, 1, 1, {0}};
+}
+
+// Byte offsets of Y0, U, Y1 and V in a packed 4:2:2 group
+struct PackedOrder {
+    int y0, u, y1, v;
+};
+
+PackedOrder PackedOrderOf(enum video_format format)
+{
+    return format == VIDEO_FORMAT_UYVY ? PackedOrder{1, 0, 3, 2} : PackedOrder{0, 1, 2, 3};
+}
+
+// Rearrange the pixels of NV12 and packed 4:2:2 frames into the planar
+// layout PlanarLayout() describes, row by row within the frame's own
+// memory: the planar rows take exactly as many bytes. Each UV row becomes
+// U then V; each packed row becomes Y, then U, then V.
+void RepackPlanar(const struct obs_source_frame *frame, FrameBufferPool &pool,
+                  const WorkBudget &budget)
+{
+    const int width = static_cast<int>(frame->width);
+    const int chroma_width = (width + 1) / 2;
+
+    if (frame->format == VIDEO_FORMAT_NV12) {
+        const int rows = (static_cast<int>(frame->height) + 1) / 2;
+        budget.ForRows(rows, [&](int stripe, int begin, int end) {
+            FrameBufferPool::StripeScratch &scratch = pool.Stripe(stripe);
+            uint8_t *uv = scratch.packed.data();
+            for (int y = begin; y < end; y++) {
+                uint8_t *row = frame->data[1] + static_cast<size_t>(y) * frame->linesize[1];
+                std::memcpy(uv, row, 2 * static_cast<size_t>(chroma_width));
+                for (int x = 0; x < chroma_width; x++) {
+                    row[x] = uv[2 * x];
+                    row[chroma_width + x] = uv[2 * x + 1];
+                }
+            }
+            const uint64_t bytes = 2ULL * chroma_width * (end - begin);
+            scratch.traffic.read += bytes;
+            scratch.traffic.written += bytes;
+        });
+    } else if (frame->format == VIDEO_FORMAT_YUY2 || frame->format == VIDEO_FORMAT_UYVY) {
+        const PackedOrder order = PackedOrderOf(frame->format);
+        budget.ForRows(static_cast<int>(frame->height), [&](int stripe, int begin, int end) {
+            FrameBufferPool::StripeScratch &scratch = pool.Stripe(stripe);
+            uint8_t *packed = scratch.packed.data();
+            for (int y = begin; y < end; y++) {
+                uint8_t *row = frame->data[0] + static_cast<size_t>(y) * frame->linesize[0];
+                std::memcpy(packed, row, 4 * static_cast<size_t>(chroma_width));
+                uint8_t *u = row + width;
+                uint8_t *v = u + chroma_width;
+                for (int x = 0; x < chroma_width; x++) {
+                    const uint8_t *group = packed + 4 * x;
+                    row[2 * x] = group[order.y0];
+                    if (2 * x + 1 < width) {
+                        row[2 * x + 1] = group[order.y1];
+                    }
+                    u[x] = group[order.u];
+                    v[x] = group[order.v];
+                }
+            }
+            const uint64_t bytes = 4ULL * chroma_width * (end - begin);
+            scratch.traffic.read += bytes;
+            scratch.traffic.written += bytes;
+        });
+    }
+}
+
+// Point a frame's chroma planes at where RepackPlanar() puts them; no
+// pixels move. Plane 0 keeps its pointer and linesize, and so does NV12's
+// UV plane: OBS copies the next frame into this one through those once it
+// is released (resetting the format as it does). Y800 frames have no room
+// for chroma and borrow a neutral plane from the pool, in the slots OBS
+// never writes for Y800.
+void PlanarLayout(struct obs_source_frame *frame, FrameBufferPool &pool)
+{
+    const int width = static_cast<int>(frame->width);
+    const int chroma_width = (width + 1) / 2;
+
+    switch (frame->format) {
+    case VIDEO_FORMAT_NV12:
+        frame->data[2] = frame->data[1] + chroma_width;
+        frame->linesize[2] = frame->linesize[1];
+        break;
+    case VIDEO_FORMAT_YUY2:
+    case VIDEO_FORMAT_UYVY:
+        frame->data[1] = frame->data[0] + width;
+        frame->data[2] = frame->data[1] + chroma_width;
+        frame->linesize[1] = frame->linesize[0];
+        frame->linesize[2] = frame->linesize[0];
+        break;
+    case VIDEO_FORMAT_Y800: {
+        const int chroma_height = (static_cast<int>(frame->height) + 1) / 2;
+        const bool filled = pool.HasPlane(1, FrameBufferPool::kNeutralChroma, chroma_height,
+                                          chroma_width, CV_8UC1);
+        cv::Mat &chroma = pool.Plane(1, FrameBufferPool::kNeutralChroma, chroma_height,
+                                     chroma_width, CV_8UC1);
+        if (!filled) {
+            chroma.setTo(128);
+        }
+        frame->data[1] = chroma.data;
+        frame->data[2] = chroma.data;
+        frame->linesize[1] = static_cast<uint32_t>(chroma.step);
+        frame->linesize[2] = static_cast<uint32_t>(chroma.step);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+// Relabel a frame as its alpha format, in its planar layout (pixels are
+// not moved). Planar frames without an alpha plane borrow the pool's; OBS
+// reads it while uploading the frame, which happens before the filter
+// sees another one.
+PlaneView AttachAlpha(struct obs_source_frame *frame, FrameBufferPool &pool)
+{
+    const enum video_format format = AlphaFormat(frame->format);
+
+    PlanarLayout(frame, pool);
+    if (!PackedAlpha(format) && (frame->format != format || !frame->data[3])) {
+        cv::Mat &alpha = pool.Plane(0, FrameBufferPool::kAlpha, static_cast<int>(frame->height),
+                                    static_cast<int>(frame->width), CV_8UC1);
+        frame->data[3] = alpha.data;
+        frame->linesize[3] = static_cast<uint32_t>(alpha.step);
+    }
+    frame->format = format;
+    return AlphaPlane(frame);
+}
+
+// Alpha samples `step` bytes apart
+void CopyAlpha(uint8_t *dst, int dst_step, const uint8_t *src, int src_step, int width)
+{
+    if (dst_step == 1 && src_step == 1) {
+        std::memcpy(dst, src, static_cast<size_t>(width));
+        return;
+    }
+    for (int x = 0; x < width; x++) {
+        dst[x * dst_step] = src[x * src_step];
+    }
+}
+
+void FillAlpha(uint8_t *dst, int step, uint8_t value, int width)
+{
+    if (step == 1) {
+        std::memset(dst, value, static_cast<size_t>(width));
+        return;
+    }
+    for (int x = 0; x < width; x++) {
+        dst[x * step] = value;
+    }
+}
+
+void StoreAlpha(const BlendKernels &kernels, uint8_t *dst, int step, const float *alpha,
+                int width)
+{
+    kernels.store_alpha(dst, alpha, width, step);
+}
+
+void StoreAlpha(const BlendKernels &, uint8_t *dst, int step, const uint8_t *alpha, int width)
+{
+    CopyAlpha(dst, step, alpha, 1, width);
+}
+
+// Write the mask into an alpha plane instead of blending. Solid runs are
+// filled without interpolating, but every pixel is written: the plane
+// holds whatever the source or the previous frame left in it.
+template <typename Alpha>
+void AlphaRows(const PlaneView &plane, const MaskView &mask, Alpha *alpha,
+               MaskView::RowScratch &scratch, MemoryTraffic &traffic, int begin, int end)
+{
+    const BlendKernels &kernels = BlendKernelSelect::Get();
+    const int step = plane.channels;
+
+    // A byte inside packed pixels costs the whole pixel a round trip
+    const uint64_t row_bytes = static_cast<uint64_t>(plane.width) * step;
+
+    for (int y = begin; y < end; y++) {
+        uint8_t *row = plane.Row(y);
+
+        for (const AlphaSpan &span :
+             mask.SampleSpans(plane.width, plane.height, y, alpha, scratch)) {
+            uint8_t *dst = row + static_cast<size_t>(span.begin) * step;
+            const int width = span.end - span.begin;
+
+            switch (span.kind) {
+            case AlphaSpan::kBackground:
+                FillAlpha(dst, step, 0, width);
+                break;
+            case AlphaSpan::kForeground:
+                FillAlpha(dst, step, 255, width);
+                break;
+            case AlphaSpan::kPartial:
+                StoreAlpha(kernels, dst, step, alpha + span.begin, width);
+                break;
+            }
+        }
+        traffic.read += step > 1 ? row_bytes : 0;
+        traffic.written += row_bytes;
+    }
+}
+
+} // namespace
+
+uint64_t FrameBytes(const struct obs_source_frame *frame)
+{
+    const FrameView view(frame);
+    uint64_t bytes = 0;
+
+    for (int i = 0; i < view.PlaneCount(); i++) {
+        bytes += view.Plane(i).Bytes();
+    }
+
+    return bytes;
+}
+
+void SaveFrame(const struct obs_source_frame *frame, FrameBufferPool &pool)
+{
+    const FrameView view(frame);
+
+    for (int i = 0; i < view.PlaneCount(); i++) {
+        const PlaneView &plane = view.Plane(i);
+        const int type = PlaneType(plane);
+        const cv::Mat source(plane.height, plane.width, type, plane.data, plane.stride);
+        source.copyTo(pool.Plane(i, FrameBufferPool::kHeld, plane.height, plane.width, type));
+        pool.CountTraffic(plane.Bytes(), plane.Bytes());
+    }
+
+    // Alpha is held on its own, so that a frame without any can be given it
+    const int width = view.Width();
+    const int height = view.Height();
+    if (!CarriesAlpha(frame)) {
+        if (pool.HasPlane(0, FrameBufferPool::kHeldAlpha, height, width, CV_8UC1)) {
+            pool.Plane(0, FrameBufferPool::kHeldAlpha, height, width, CV_8UC1).release();
+        }
+        return;
+    }
+    const PlaneView alpha = AlphaPlane(frame);
+    cv::Mat &held = pool.Plane(0, FrameBufferPool::kHeldAlpha, height, width, CV_8UC1);
+    for (int y = 0; y < height; y++) {
+        CopyAlpha(held.ptr<uint8_t>(y), 1, alpha.Row(y), alpha.channels, width);
+    }
+    pool.CountTraffic(alpha.Bytes(), held.total());
+}
+
+bool RestoreFrame(struct obs_source_frame *frame, FrameBufferPool &pool)
+{
+    // A held frame with alpha was saved in its alpha format's layout, so
+    // this one is laid out the same way before anything is copied; a copy
+    // of the frame is relabelled until the held planes are known to fit
+    const int width = static_cast<int>(frame->width);
+    const int height = static_cast<int>(frame->height);
+    const bool held_alpha = AlphaFormat(frame->format) != VIDEO_FORMAT_NONE &&
+                            pool.HasPlane(0, FrameBufferPool::kHeldAlpha, height, width,
+                                          CV_8UC1);
+    struct obs_source_frame layout = *frame;
+    PlaneView alpha = {};
+    if (held_alpha) {
+        alpha = AttachAlpha(&layout, pool);
+    }
+    const FrameView view(&layout);
+
+    for (int i = 0; i < view.PlaneCount(); i++) {
+        const PlaneView &plane = view.Plane(i);
+        if (!pool.HasPlane(i, FrameBufferPool::kHeld, plane.height, plane.width,
+                           PlaneType(plane))) {
+            return false;
+        }
+    }
+
+    for (int i = 0; i < view.PlaneCount(); i++) {
+        const PlaneView &plane = view.Plane(i);
+        const int type = PlaneType(plane);
+        cv::Mat target(plane.height, plane.width, type, plane.data, plane.stride);
+        pool.Plane(i, FrameBufferPool::kHeld, plane.height, plane.width, type).copyTo(target);
+        pool.CountTraffic(plane.Bytes(), plane.Bytes());
+    }
+
+    if (held_alpha) {
+        const cv::Mat &held = pool.Plane(0, FrameBufferPool::kHeldAlpha, height, width, CV_8UC1);
+        for (int y = 0; y < height; y++) {
+            CopyAlpha(alpha.Row(y), alpha.channels, held.ptr<uint8_t>(y), 1, width);
+        }
+        pool.CountTraffic(held.total(), alpha.Bytes());
+    }
+
+    std::memcpy(frame->data, layout.data, sizeof(frame->data));
+    std::memcpy(frame->linesize, layout.linesize, sizeof(frame->linesize));
+    frame->format = layout.format;
+    return true;
+}
+
+bool SupportsFormat(enum video_format format)
+{
+    return FrameView::Supports(format);
+}
+
+bool SupportsAlpha(enum video_format format)
+{
+    return AlphaFormat(format) != VIDEO_FORMAT_NONE;
+}
+
+const uint16_t *ResolveColor(CompositeColor &cache, uint32_t color,
+                             const struct obs_source_frame *frame)
+{
+    const FrameView view(frame);
+    const bool yuv = !view.Rgb();
+
+    if (cache.valid && cache.color == color && cache.format == frame->format &&
+        (!yuv || std::memcmp(cache.color_matrix, frame->color_matrix,
+                             sizeof(cache.color_matrix)) == 0)) {
+        return cache.value;
+    }
+
+    const float r = static_cast<float>((color >> 0) & 0xFF) / 255.0f;
+    const float g = static_cast<float>((color >> 8) & 0xFF) / 255.0f;
+    const float b = static_cast<float>((color >> 16) & 0xFF) / 255.0f;
+    float out[3] = {r, g, b};
+
+    if (yuv) {
+        // color_matrix maps (Y, U, V, 1) to RGB row by row; invert its 3x3 part
+        const float *m = frame->color_matrix;
+        const float a00 = m[0], a01 = m[1], a02 = m[2];
+        const float a10 = m[4], a11 = m[5], a12 = m[6];
+        const float a20 = m[8], a21 = m[9], a22 = m[10];
+        const float det = a00 * (a11 * a22 - a12 * a21) - a01 * (a10 * a22 - a12 * a20) +
+                          a02 * (a10 * a21 - a11 * a20);
+
+        if (std::fabs(det) > 1e-6f) {
+            const float rr = r - m[3];
+            const float gg = g - m[7];
+            const float bb = b - m[11];
+            const float inv = 1.0f / det;
+
+            out[0] = inv * ((a11 * a22 - a12 * a21) * rr + (a02 * a21 - a01 * a22) * gg +
+                            (a01 * a12 - a02 * a11) * bb);
+            out[1] = inv * ((a12 * a20 - a10 * a22) * rr + (a00 * a22 - a02 * a20) * gg +
+                            (a02 * a10 - a00 * a12) * bb);
+            out[2] = inv * ((a10 * a21 - a11 * a20) * rr + (a01 * a20 - a00 * a21) * gg +
+                            (a00 * a11 - a01 * a10) * bb);
+        } else {
+            // No usable matrix: fall back to BT.601 limited range
+            out[0] = (16.0f + 65.481f * r + 128.553f * g + 24.966f * b) / 255.0f;
+            out[1] = (128.0f - 37.797f * r - 74.203f * g + 112.0f * b) / 255.0f;
+            out[2] = (128.0f + 112.0f * r - 93.786f * g - 18.214f * b) / 255.0f;
+        }
+    }
+
+    const float scale = static_cast<float>((1 << view.SampleBits()) - 1);
+    for (int i = 0; i < 3; i++) {
+        const int code = static_cast<int>(std::clamp(out[i] * scale + 0.5f, 0.0f, scale));
+        cache.value[i] = static_cast<uint16_t>(code << view.SampleShift());
+    }
+    cache.color = color;
+    cache.format = frame->format;
+    std::memcpy(cache.color_matrix, frame->color_matrix, sizeof(cache.color_matrix));
+    cache.valid = true;
+
+    return cache.value;
+}
+
+void ReplaceBackground(struct obs_source_frame *frame, MaskView &mask, const uint16_t color[3],
+                       FrameBufferPool &pool, const WorkBudget &budget)
+{
+    const FrameView view(frame);
+
+    for (int i = 0; i < view.PlaneCount(); i++) {
+        uint16_t pixel[4];
+        PlaneColor(view.Plane(i), color, pixel);
+        BlendPlane(view.Plane(i), mask, pixel, BackgroundRows(), pool, budget);
+    }
+}
+
+bool BlurBackground(struct obs_source_frame *frame, MaskView &mask, int blur_amount,
+                    BlurQuality quality, bool tiled, bool reuse_blur, FrameBufferPool &pool,
+                    const WorkBudget &budget)
+{
+    const FrameView view(frame);
+    bool whole_planes = true;
+
+    for (int i = 0; i < view.PlaneCount(); i++) {
+        const PlaneView &plane = view.Plane(i);
+
+        // Subsampled planes get a proportionally smaller kernel along each
+        // subsampled axis, so the blur covers the same frame area on every plane
+        const int radius_x = std::max(blur_amount / plane.subsample_x, 1);
+        const int radius_y = std::max(blur_amount / plane.subsample_y, 1);
+
+        if (tiled && BlurEngine::SupportsBands(radius_x, radius_y, quality)) {
+            BlurBlendBands(plane, i, mask, radius_x, radius_y, quality, pool, budget);
+            whole_planes = false;
+            continue;
+        }
+
+        const int type = PlaneType(plane);
+        BackgroundRows background;
+        if (reuse_blur &&
+            pool.HasPlane(i, FrameBufferPool::kBlurred, plane.height, plane.width, type)) {
+            background.image =
+                    pool.Plane(i, FrameBufferPool::kBlurred, plane.height, plane.width, type);
+        } else {
+            cv::Mat source(plane.height, plane.width, type, plane.data, plane.stride);
+            background.image =
+                    BlurEngine::Blur(source, i, radius_x, radius_y, quality, pool, budget);
+        }
+        BlendPlane(plane, mask, nullptr, background, pool, budget);
+    }
+
+    return whole_planes;
+}
+
+bool WriteAlpha(struct obs_source_frame *frame, MaskView &mask, FrameBufferPool &pool,
+                const WorkBudget &budget)
+{
+    if (!SupportsAlpha(frame->format)) {
+        return false;
+    }
+
+    RepackPlanar(frame, pool, budget);
+    const PlaneView plane = AttachAlpha(frame, pool);
+    mask.Prepare(plane.width);
+
+    budget.ForRows(plane.height, [&](int stripe, int begin, int end) {
+        FrameBufferPool::StripeScratch &scratch = pool.Stripe(stripe);
+        if (mask.FixedPoint()) {
+            AlphaRows(plane, mask, scratch.alpha_q.data(), scratch.mask, scratch.traffic, begin,
+                      end);
+        } else {
+            AlphaRows(plane, mask, scratch.alpha.data(), scratch.mask, scratch.traffic, begin,
+                      end);
+        }
+    });
+
+    return true;
+}
+
+} // namespace Compositor
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <obs-module.h>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include "blur-engine.h"
+#include "frame-buffer-pool.h"
+#include "mask-view.h"
+#include "thread-pool.h"
+
+// Replacement colour expressed in a frame's own colour space. It is only
+// recomputed when the colour setting or the frame's colour matrix changes,
+// so the per-frame cost is a comparison.
+struct CompositeColor {
+    uint32_t color = 0;             // OBS colour (0xAABBGGRR) it was built from
+    enum video_format format = VIDEO_FORMAT_NONE;
+    float color_matrix[16] = {};
+    uint16_t value[3] = {};         // Y/U/V or R/G/B at the format's sample depth
+    bool valid = false;
+};
+
+namespace Compositor {
+
+/**
+ * Check whether frames of this format can be composited in place
+ * @param format OBS video format
+ * @return true for every format FrameView describes
+ */
+bool SupportsFormat(enum video_format format);
+
+/**
+ * Size of a frame's visible pixels, summed over its planes
+ * @param frame Frame of a supported format
+ * @return Bytes, excluding row padding
+ */
+uint64_t FrameBytes(const struct obs_source_frame *frame);
+
+/**
+ * Check whether frames of this format can carry the mask as alpha
+ * @param format OBS video format
+ * @return true for RGBA, BGRA, BGRX, the 8-bit YUV formats and the alpha
+ *         variants I40A, I42A and YUVA; false for the 10-bit formats
+ */
+bool SupportsAlpha(enum video_format format);
+
+/**
+ * Keep a copy of a composited frame for RestoreFrame(), alpha included
+ * @param frame Frame after compositing
+ * @param pool Per-filter scratch buffers, configured for this frame
+ */
+void SaveFrame(const struct obs_source_frame *frame, FrameBufferPool &pool);
+
+/**
+ * Overwrite a frame with the copy kept by SaveFrame(); a held alpha is
+ * attached as WriteAlpha() would
+ * @param frame Frame to overwrite
+ * @param pool Per-filter scratch buffers, configured for this frame
+ * @return false if no copy of this layout is held; the frame is untouched
+ */
+bool RestoreFrame(struct obs_source_frame *frame, FrameBufferPool &pool);
+
+/**
+ * Convert an OBS colour into the colour space of a frame
+ * @param cache Cached conversion, refreshed if stale
+ * @param color OBS colour (0xAABBGGRR)
+ * @param frame Frame whose format and colour matrix are used
+ * @return Three channel values: Y/U/V for YUV formats, R/G/B otherwise;
+ *         10-bit codes for I010 and P010 (shifted into the top bits for P010)
+ */
+const uint16_t *ResolveColor(CompositeColor &cache, uint32_t color,
+                             const struct obs_source_frame *frame);
+
+/**
+ * Blend the background of a frame towards a solid colour, in place.
+ * Luma is blended at full resolution, chroma at chroma resolution, and
+ * packed 4:2:2 in two-pixel groups.
+ * @param frame Frame to modify
+ * @param mask Model-resolution alpha, interpolated row by row while blending
+ * @param color Colour from ResolveColor()
+ * @param pool Per-filter scratch buffers, configured for this frame
+ * @param budget Threads the row stripes may use
+ */
+void ReplaceBackground(struct obs_source_frame *frame, MaskView &mask, const uint16_t color[3],
+                       FrameBufferPool &pool, const WorkBudget &budget);
+
+/**
+ * Blend the background of a frame towards a blurred copy of itself, in place
+ * @param frame Frame to modify
+ * @param mask Model-resolution alpha, interpolated row by row while blending
+ * @param blur_amount Gaussian radius at luma resolution
+ * @param quality Blur approximation (see BlurEngine)
+ * @param tiled Blur and blend band by band while each band is in cache,
+ *              rather than blurring whole planes first; ignored for the
+ *              fast blur, which has no band form
+ * @param reuse_blur Keep the blurred planes left by the previous call
+ *                   instead of blurring again, when they exist at this
+ *                   layout; the caller decides the scene has not changed
+ * @param pool Per-filter scratch buffers, configured for this frame
+ * @param budget Threads the row stripes may use
+ * @return true if the pool now holds this frame's blurred planes, so the
+ *         next call may reuse them
+ */
+bool BlurBackground(struct obs_source_frame *frame, MaskView &mask, int blur_amount,
+                    BlurQuality quality, bool tiled, bool reuse_blur, FrameBufferPool &pool,
+                    const WorkBudget &budget);
+
+/**
+ * Write the mask into a frame's alpha instead of blending; colour is left
+ * untouched. RGBA and BGRA get it in their A channel and BGRX becomes
+ * BGRA. I420, I422 and I444 frames are given a full-resolution alpha plane
+ * from the pool and become I40A, I42A and YUVA; frames already in those
+ * formats are written in place. NV12 and Y800 become I40A and YUY2/UYVY
+ * I42A: NV12 and packed rows are repacked into planar order in place, and
+ * Y800 gets neutral chroma from the pool.
+ * @param frame Frame to modify; its format and alpha plane may change
+ * @param mask Model-resolution alpha, interpolated row by row
+ * @param pool Per-filter scratch buffers, configured for this frame
+ * @param budget Threads the row stripes may use
+ * @return false if the format has no alpha variant; the frame is untouched
+ */
+bool WriteAlpha(struct obs_source_frame *frame, MaskView &mask, FrameBufferPool &pool,
+                const WorkBudget &budget);
+
+} // namespace Compositor
@@ -0,0 +1,183 @@
+#include "frame-sampler.h"
+#include <algorithm>
+#include <cmath>
+
+template <typename Sample>
+int FrameSampler::SamplePlane(const PlaneView &plane, float scale, int width, int height,
+                              const WorkBudget &budget)
+{
+    const int plane_width = plane.width;
+    const int plane_height = plane.height;
+    const int pixel_size = plane.channels;
+
+    // Channels holding each component; packed 4:2:2 has two luma channels
+    int channel[3][4];
+    int channel_count[3] = {};
+    int written = 0;
+    for (int c = 0; c < plane.blend_channels; c++) {
+        const int component = plane.color_channel[c];
+        channel[component][channel_count[component]++] = c;
+        written |= 1 << component;
+    }
+
+    x_bounds_.resize(width + 1);
+    for (int k = 0; k < 3; k++) {
+        if (channel_count[k]) {
+            planes_[k].resize(static_cast<size_t>(width) * height);
+        }
+    }
+
+    for (int x = 0; x <= width; x++) {
+        x_bounds_[x] = static_cast<int>(static_cast<int64_t>(x) * plane_width / width);
+    }
+
+    // Output rows only read their own source rows, so stripes are independent
+    budget.ForRows(height, [&](int stripe, int begin, int end) {
+        std::vector<uint32_t> &column_sums = column_sums_[stripe];
+        column_sums.resize(static_cast<size_t>(plane_width) * pixel_size);
+
+        for (int oy = begin; oy < end; oy++) {
+            const int y0 = static_cast<int>(static_cast<int64_t>(oy) * plane_height / height);
+            const int y1 = std::max(
+                    static_cast<int>(static_cast<int64_t>(oy + 1) * plane_height / height),
+                    y0 + 1);
+
+            // Sum the source rows that fall into this output row
+            std::fill(column_sums.begin(), column_sums.end(), 0u);
+            for (int y = y0; y < y1; y++) {
+                const Sample *row = reinterpret_cast<const Sample *>(plane.Row(y));
+                for (size_t i = 0; i < column_sums.size(); i++) {
+                    column_sums[i] += row[i];
+                }
+            }
+
+            // Then the columns that fall into each output pixel
+            for (int ox = 0; ox < width; ox++) {
+                const int x0 = std::min(x_bounds_[ox], plane_width - 1);
+                const int x1 = std::max(x_bounds_[ox + 1], x0 + 1);
+                const float area_scale = scale / static_cast<float>((x1 - x0) * (y1 - y0));
+
+                for (int k = 0; k < 3; k++) {
+                    if (!channel_count[k]) {
+                        continue;
+                    }
+
+                    uint32_t sum = 0;
+                    for (int j = 0; j < channel_count[k]; j++) {
+                        for (int x = x0; x < x1; x++) {
+                            sum += column_sums[x * pixel_size + channel[k][j]];
+                        }
+                    }
+                    planes_[k][oy * width + ox] =
+                            static_cast<float>(sum) * area_scale / channel_count[k];
+                }
+            }
+        }
+    });
+
+    return written;
+}
+
+void FrameSampler::ConvertRows(const float *m, bool yuv, int width, cv::Mat &rgb, int begin,
+                               int end) const
+{
+    const float *p0 = planes_[0].data();
+    const float *p1 = planes_[1].data();
+    const float *p2 = planes_[2].data();
+
+    for (int y = begin; y < end; y++) {
+        uint8_t *out = rgb.ptr<uint8_t>(y);
+
+        for (int x = 0; x < width; x++) {
+            const size_t i = static_cast<size_t>(y) * width + x;
+
+            if (!yuv) {
+                out[x * 3 + 0] = static_cast<uint8_t>(p0[i] + 0.5f);
+                out[x * 3 + 1] = static_cast<uint8_t>(p1[i] + 0.5f);
+                out[x * 3 + 2] = static_cast<uint8_t>(p2[i] + 0.5f);
+                continue;
+            }
+
+            const float Y = p0[i] * (1.0f / 255.0f);
+            const float U = p1[i] * (1.0f / 255.0f);
+            const float V = p2[i] * (1.0f / 255.0f);
+
+            for (int c = 0; c < 3; c++) {
+                const float *row = m + c * 4;
+                const float value = row[0] * Y + row[1] * U + row[2] * V + row[3];
+                out[x * 3 + c] =
+                        static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+            }
+        }
+    }
+}
+
+bool FrameSampler::Sample(const struct obs_source_frame *frame, const cv::Rect &region,
+                          int width, int height, cv::Mat &rgb, const WorkBudget &budget)
+{
+    const FrameView view(frame);
+    if (view.PlaneCount() == 0) {
+        return false;
+    }
+
+    // Ten-bit samples are brought to the 8-bit range as they are averaged
+    const float scale = 255.0f / static_cast<float>(view.MaxSample());
+    int written = 0;
+
+    for (int i = 0; i < view.PlaneCount(); i++) {
+        const PlaneView plane =
+                view.Plane(i).Crop(region.x, region.y, region.width, region.height);
+        written |= plane.sample_size == 2
+                           ? SamplePlane<uint16_t>(plane, scale, width, height, budget)
+                           : SamplePlane<uint8_t>(plane, scale, width, height, budget);
+    }
+
+    // Y800 has no chroma to sample
+    for (int k = 1; k < 3; k++) {
+        if (!(written & (1 << k))) {
+            planes_[k].assign(static_cast<size_t>(width) * height, 128.0f);
+        }
+    }
+
+    const bool yuv = !view.Rgb();
+
+    width_ = width;
+    height_ = height;
+    yuv_ = yuv;
+    rgb.create(height, width, CV_8UC3);
+
+    // color_matrix maps normalized (Y, U, V, 1) to RGB and already accounts
+    // for the frame's range; fall back to BT.601 limited if it is unset
+    static const float bt601[16] = {1.164384f, 0.000000f, 1.596027f, -0.874202f,
+                                    1.164384f, -0.391762f, -0.812968f, 0.531668f,
+                                    1.164384f, 2.017232f, 0.000000f, -1.085631f,
+                                    0.0f, 0.0f, 0.0f, 1.0f};
+    const float *m = frame->color_matrix;
+    if (m[0] == 0.0f && m[5] == 0.0f && m[10] == 0.0f) {
+        m = bt601;
+    }
+
+    budget.ForRows(height, [&](int, int begin, int end) {
+        ConvertRows(m, yuv, width, rgb, begin, end);
+    });
+
+    return true;
+}
+
+void FrameSampler::Luma(cv::Mat &gray) const
+{
+    gray.create(height_, width_, CV_8UC1);
+
+    for (int y = 0; y < height_; y++) {
+        uint8_t *out = gray.ptr<uint8_t>(y);
+        const size_t row = static_cast<size_t>(y) * width_;
+
+        for (int x = 0; x < width_; x++) {
+            const size_t i = row + x;
+            const float value = yuv_ ? planes_[0][i]
+                                     : 0.299f * planes_[0][i] + 0.587f * planes_[1][i] +
+                                               0.114f * planes_[2][i];
+            out[x] = static_cast<uint8_t>(value + 0.5f);
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <obs-module.h>
+#include <cstdint>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "frame-view.h"
+#include "thread-pool.h"
+
+// Builds the model input straight from a frame's planes. Each plane is
+// area-averaged down to the model resolution first and only the small result
+// is converted to RGB, so the camera frame is read once and never converted
+// at full resolution.
+class FrameSampler {
+public:
+    /**
+     * Area-sample a region of a frame into an RGB image
+     * @param frame Source frame of any format FrameView supports
+     * @param region Part of the frame to sample, in frame pixels; even
+     *               offsets keep the chroma planes aligned with it
+     * @param width Output width (model input width)
+     * @param height Output height (model input height)
+     * @param rgb Receives a CV_8UC3 image in R, G, B order
+     * @param budget Threads the output row stripes may use
+     * @return false if the frame format is not supported
+     */
+    bool Sample(const struct obs_source_frame *frame, const cv::Rect &region, int width,
+                int height, cv::Mat &rgb, const WorkBudget &budget);
+
+    /**
+     * Luma of the last sampled frame at the same size: the averaged Y plane
+     * for YUV frames, BT.601 weights for RGB ones
+     * @param gray Receives a CV_8UC1 image
+     */
+    void Luma(cv::Mat &gray) const;
+
+private:
+    // Box-average a plane into planes_[] by component, averaging every
+    // channel that holds it and multiplying by `scale` to reach the 8-bit
+    // range; returns a bit mask of the components written
+    template <typename Sample>
+    int SamplePlane(const PlaneView &plane, float scale, int width, int height,
+                    const WorkBudget &budget);
+
+    // Convert output rows [begin, end) of planes_ into rgb
+    void ConvertRows(const float *m, bool yuv, int width, cv::Mat &rgb, int begin,
+                     int end) const;
+
+    std::vector<uint32_t> column_sums_[ThreadPool::kMaxStripes];   // Per stripe
+    std::vector<int> x_bounds_;
+    std::vector<float> planes_[3];
+    int width_ = 0;
+    int height_ = 0;
+    bool yuv_ = true;
+};
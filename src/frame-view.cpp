@@ -0,0 +1,130 @@
+#include "frame-view.h"
+#include <algorithm>
+
+uint64_t PlaneView::Bytes() const
+{
+    return static_cast<uint64_t>(width) * channels * sample_size * height;
+}
+
+PlaneView PlaneView::Crop(int x, int y, int width, int height) const
+{
+    const int left = x / subsample_x;
+    const int top = y / subsample_y;
+    PlaneView crop = *this;
+
+    crop.data = Row(top) + static_cast<size_t>(left) * channels * sample_size;
+    crop.width = std::min((width + subsample_x - 1) / subsample_x, this->width - left);
+    crop.height = std::min((height + subsample_y - 1) / subsample_y, this->height - top);
+    return crop;
+}
+
+FrameView::FrameView(const struct obs_source_frame *frame)
+    : plane_count_(0)
+    , format_(frame->format)
+    , width_(static_cast<int>(frame->width))
+    , height_(static_cast<int>(frame->height))
+    , rgb_(false)
+    , sample_bits_(8)
+    , sample_shift_(0)
+{
+    const int w = width_;
+    const int h = height_;
+    const int cw = (w + 1) / 2;
+    const int ch = (h + 1) / 2;
+    uint8_t *const *data = frame->data;
+    const uint32_t *linesize = frame->linesize;
+
+    // The alpha variants read like their colour formats; the alpha plane
+    // (data[3]) is not part of the view
+    switch (format_) {
+    case VIDEO_FORMAT_I420:
+    case VIDEO_FORMAT_I40A:
+        planes_[0] = {data[0], linesize[0], w, h, 1, 1, 1, 1, 1, {0}};
+        planes_[1] = {data[1], linesize[1], cw, ch, 2, 2, 1, 1, 1, {1}};
+        planes_[2] = {data[2], linesize[2], cw, ch, 2, 2, 1, 1, 1, {2}};
+        plane_count_ = 3;
+        break;
+    case VIDEO_FORMAT_NV12:
+        planes_[0] = {data[0], linesize[0], w, h, 1, 1, 1, 1, 1, {0}};
+        planes_[1] = {data[1], linesize[1], cw, ch, 2, 2, 2, 2, 1, {1, 2}};
+        plane_count_ = 2;
+        break;
+    case VIDEO_FORMAT_I422:
+    case VIDEO_FORMAT_I42A:
+        planes_[0] = {data[0], linesize[0], w, h, 1, 1, 1, 1, 1, {0}};
+        planes_[1] = {data[1], linesize[1], cw, h, 2, 1, 1, 1, 1, {1}};
+        planes_[2] = {data[2], linesize[2], cw, h, 2, 1, 1, 1, 1, {2}};
+        plane_count_ = 3;
+        break;
+    case VIDEO_FORMAT_I444:
+    case VIDEO_FORMAT_YUVA:
+        planes_[0] = {data[0], linesize[0], w, h, 1, 1, 1, 1, 1, {0}};
+        planes_[1] = {data[1], linesize[1], w, h, 1, 1, 1, 1, 1, {1}};
+        planes_[2] = {data[2], linesize[2], w, h, 1, 1, 1, 1, 1, {2}};
+        plane_count_ = 3;
+        break;
+    case VIDEO_FORMAT_Y800:
+        planes_[0] = {data[0], linesize[0], w, h, 1, 1, 1, 1, 1, {0}};
+        plane_count_ = 1;
+        break;
+    case VIDEO_FORMAT_YUY2:
+        planes_[0] = {data[0], linesize[0], cw, h, 2, 1, 4, 4, 1, {0, 1, 0, 2}};
+        plane_count_ = 1;
+        break;
+    case VIDEO_FORMAT_UYVY:
+        planes_[0] = {data[0], linesize[0], cw, h, 2, 1, 4, 4, 1, {1, 0, 2, 0}};
+        plane_count_ = 1;
+        break;
+    case VIDEO_FORMAT_RGBA:
+        planes_[0] = {data[0], linesize[0], w, h, 1, 1, 4, 3, 1, {0, 1, 2}};
+        plane_count_ = 1;
+        rgb_ = true;
+        break;
+    case VIDEO_FORMAT_BGRA:
+    case VIDEO_FORMAT_BGRX:
+        planes_[0] = {data[0], linesize[0], w, h, 1, 1, 4, 3, 1, {2, 1, 0}};
+        plane_count_ = 1;
+        rgb_ = true;
+        break;
+    case VIDEO_FORMAT_I010:
+        planes_[0] = {data[0], linesize[0], w, h, 1, 1, 1, 1, 2, {0}};
+        planes_[1] = {data[1], linesize[1], cw, ch, 2, 2, 1, 1, 2, {1}};
+        planes_[2] = {data[2], linesize[2], cw, ch, 2, 2, 1, 1, 2, {2}};
+        plane_count_ = 3;
+        sample_bits_ = 10;
+        break;
+    case VIDEO_FORMAT_P010:
+        planes_[0] = {data[0], linesize[0], w, h, 1, 1, 1, 1, 2, {0}};
+        planes_[1] = {data[1], linesize[1], cw, ch, 2, 2, 2, 2, 2, {1, 2}};
+        plane_count_ = 2;
+        sample_bits_ = 10;
+        sample_shift_ = 6;
+        break;
+    default:
+        break;
+    }
+}
+
+bool FrameView::Supports(enum video_format format)
+{
+    switch (format) {
+    case VIDEO_FORMAT_I420:
+    case VIDEO_FORMAT_I40A:
+    case VIDEO_FORMAT_NV12:
+    case VIDEO_FORMAT_I422:
+    case VIDEO_FORMAT_I42A:
+    case VIDEO_FORMAT_I444:
+    case VIDEO_FORMAT_YUVA:
+    case VIDEO_FORMAT_Y800:
+    case VIDEO_FORMAT_YUY2:
+    case VIDEO_FORMAT_UYVY:
+    case VIDEO_FORMAT_RGBA:
+    case VIDEO_FORMAT_BGRA:
+    case VIDEO_FORMAT_BGRX:
+    case VIDEO_FORMAT_I010:
+    case VIDEO_FORMAT_P010:
+        return true;
+    default:
+        return false;
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <obs-module.h>
+#include <cstddef>
+#include <cstdint>
+
+// One plane of a frame, where the frame already keeps it: its own pointer
+// and its own stride, never assumed to follow the previous plane. Packed
+// 4:2:2 (YUY2, UYVY) is one plane of two-pixel groups, Y0 U Y1 V in the
+// format's order, so a group reads and blends as one four-channel pixel.
+struct PlaneView {
+    uint8_t *data;
+    size_t stride;          // Bytes from one row to the next (the frame's linesize)
+    int width;              // Pixels, or two-pixel groups, per row
+    int height;
+    int subsample_x;        // Frame pixels per plane pixel: 1 or 2
+    int subsample_y;
+    int channels;           // Interleaved samples per pixel
+    int blend_channels;     // Leading channels that carry colour (RGBA skips A)
+    int sample_size;        // Bytes per sample: 2 for the 10-bit formats
+    int color_channel[4];   // Component (Y/U/V or R/G/B) each colour channel holds
+
+    uint8_t *Row(int y) const { return data + static_cast<size_t>(y) * stride; }
+
+    // Visible bytes, excluding row padding
+    uint64_t Bytes() const;
+
+    /**
+     * The part of the plane covering a rectangle of frame pixels
+     * @param x Left edge in frame pixels; even for subsampled planes
+     * @param y Top edge in frame pixels; even for vertically subsampled planes
+     * @param width Width in frame pixels
+     * @param height Height in frame pixels
+     * @return View of the same memory with the same stride
+     */
+    PlaneView Crop(int x, int y, int width, int height) const;
+};
+
+// Every plane of a frame as it sits in memory. Built straight from the
+// frame's data[] and linesize[], so padded rows and separately allocated
+// planes are read and written in place and nothing is ever repacked. The
+// sampler, compositor and refiner all take their planes from here.
+class FrameView {
+public:
+    static constexpr int kMaxPlanes = 3;
+
+    explicit FrameView(const struct obs_source_frame *frame);
+
+    /**
+     * Check whether frames of a format can be viewed
+     * @param format OBS video format
+     * @return true for I420, NV12, I422, I444, Y800, YUY2, UYVY, RGBA, BGRA,
+     *         BGRX, I010, P010, and I40A, I42A and YUVA (colour planes only)
+     */
+    static bool Supports(enum video_format format);
+
+    // 0 for unsupported formats
+    int PlaneCount() const { return plane_count_; }
+    const PlaneView &Plane(int index) const { return planes_[index]; }
+
+    enum video_format Format() const { return format_; }
+    int Width() const { return width_; }
+    int Height() const { return height_; }
+
+    // Components are R/G/B rather than Y/U/V
+    bool Rgb() const { return rgb_; }
+
+    // Significant bits per sample, and how far up the sample they sit
+    // (P010 keeps its 10 bits at the top of each word)
+    int SampleBits() const { return sample_bits_; }
+    int SampleShift() const { return sample_shift_; }
+    int MaxSample() const { return ((1 << sample_bits_) - 1) << sample_shift_; }
+
+private:
+    PlaneView planes_[kMaxPlanes];
+    int plane_count_;
+    enum video_format format_;
+    int width_;
+    int height_;
+    bool rgb_;
+    int sample_bits_;
+    int sample_shift_;
+};
@@ -0,0 +1,106 @@
+#include "guided-filter.h"
+#include "mask-view.h"
+#include <algorithm>
+
+namespace {
+
+// Guide variance (luma in 0..1) is regularized by this, so flat or noisy
+// areas are smoothed rather than made to follow the noise
+constexpr float kEpsilon = 1e-3f;
+
+// Radii from this up compute the coefficients at half resolution
+constexpr int kSubsampleFrom = 4;
+
+} // namespace
+
+void GuidedFilter::Apply(const cv::Mat &guide, const cv::Mat &mask, cv::Mat &smoothed,
+                         int radius)
+{
+    const cv::Mat *gray = &guide;
+    if (guide.channels() == 3) {
+        cv::cvtColor(guide, gray_, cv::COLOR_RGB2GRAY);
+        gray = &gray_;
+    }
+    gray->convertTo(guide_, CV_32F, 1.0 / 255.0);
+
+    const int scale = radius >= kSubsampleFrom ? 2 : 1;
+    const cv::Mat *guide_small = &guide_;
+    const cv::Mat *mask_small = &mask;
+    if (scale > 1) {
+        const cv::Size size((mask.cols + 1) / 2, (mask.rows + 1) / 2);
+        cv::resize(guide_, guide_small_, size, 0, 0, cv::INTER_AREA);
+        cv::resize(mask, mask_small_, size, 0, 0, cv::INTER_AREA);
+        guide_small = &guide_small_;
+        mask_small = &mask_small_;
+    }
+
+    const int rows = mask_small->rows;
+    const int cols = mask_small->cols;
+    const int small_radius = std::max(radius / scale, 1);
+    const cv::Size window(small_radius * 2 + 1, small_radius * 2 + 1);
+
+    product_.create(rows, cols, CV_32FC1);
+    square_.create(rows, cols, CV_32FC1);
+    for (int y = 0; y < rows; y++) {
+        const float *i = guide_small->ptr<float>(y);
+        const float *p = mask_small->ptr<float>(y);
+        float *ip = product_.ptr<float>(y);
+        float *ii = square_.ptr<float>(y);
+        for (int x = 0; x < cols; x++) {
+            ip[x] = i[x] * p[x];
+            ii[x] = i[x] * i[x];
+        }
+    }
+
+    cv::boxFilter(*guide_small, mean_guide_, CV_32F, window);
+    cv::boxFilter(*mask_small, mean_mask_, CV_32F, window);
+    cv::boxFilter(product_, mean_product_, CV_32F, window);
+    cv::boxFilter(square_, mean_square_, CV_32F, window);
+
+    // Where the window's mask is solid the covariance is exactly zero, so
+    // a = 0 and b keeps the solid value
+    a_.create(rows, cols, CV_32FC1);
+    b_.create(rows, cols, CV_32FC1);
+    for (int y = 0; y < rows; y++) {
+        const float *mi = mean_guide_.ptr<float>(y);
+        const float *mp = mean_mask_.ptr<float>(y);
+        const float *mip = mean_product_.ptr<float>(y);
+        const float *mii = mean_square_.ptr<float>(y);
+        float *a = a_.ptr<float>(y);
+        float *b = b_.ptr<float>(y);
+        for (int x = 0; x < cols; x++) {
+            const float variance = mii[x] - mi[x] * mi[x];
+            const float covariance = mip[x] - mi[x] * mp[x];
+            a[x] = covariance / (variance + kEpsilon);
+            b[x] = mp[x] - a[x] * mi[x];
+        }
+    }
+
+    cv::boxFilter(a_, mean_a_, CV_32F, window);
+    cv::boxFilter(b_, mean_b_, CV_32F, window);
+
+    const cv::Mat *a_full = &mean_a_;
+    const cv::Mat *b_full = &mean_b_;
+    if (scale > 1) {
+        cv::resize(mean_a_, a_full_, mask.size(), 0, 0, cv::INTER_LINEAR);
+        cv::resize(mean_b_, b_full_, mask.size(), 0, 0, cv::INTER_LINEAR);
+        a_full = &a_full_;
+        b_full = &b_full_;
+    }
+
+    // The model is applied to the full-resolution guide; results within
+    // kSolidEpsilon of 0 or 1 are snapped so solid spans stay solid
+    smoothed.create(mask.rows, mask.cols, CV_32FC1);
+    for (int y = 0; y < mask.rows; y++) {
+        const float *i = guide_.ptr<float>(y);
+        const float *a = a_full->ptr<float>(y);
+        const float *b = b_full->ptr<float>(y);
+        float *out = smoothed.ptr<float>(y);
+        for (int x = 0; x < mask.cols; x++) {
+            const float value = std::clamp(a[x] * i[x] + b[x], 0.0f, 1.0f);
+            out[x] = value <= MaskView::kSolidEpsilon          ? 0.0f
+                   : value >= 1.0f - MaskView::kSolidEpsilon ? 1.0f
+                                                              : value;
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+// Edge-aware mask smoothing guided by the frame's luma (the fast guided
+// filter of He and Sun). Within each window the output is a linear
+// function of the guide, so mask edges settle onto luma edges instead of
+// spreading into halos around hair and fingers, and each box filter costs
+// the same whatever the radius. From a radius of 4 the coefficients are
+// computed at half resolution and interpolated back up.
+class GuidedFilter {
+public:
+    /**
+     * Smooth a mask along the edges of a guide image
+     * @param guide CV_8UC3 RGB or CV_8UC1 luma, the same size as the mask
+     * @param mask CV_32FC1 mask in [0, 1]
+     * @param smoothed Receives the CV_32FC1 result; must not be `mask`
+     * @param radius Window radius in mask pixels
+     */
+    void Apply(const cv::Mat &guide, const cv::Mat &mask, cv::Mat &smoothed, int radius);
+
+private:
+    cv::Mat gray_;
+    cv::Mat guide_;         // Luma in [0, 1]
+    cv::Mat guide_small_;
+    cv::Mat mask_small_;
+    cv::Mat product_;       // guide * mask
+    cv::Mat square_;        // guide * guide
+    cv::Mat mean_guide_;
+    cv::Mat mean_mask_;
+    cv::Mat mean_product_;
+    cv::Mat mean_square_;
+    cv::Mat a_;             // Per-window model: mask = a * guide + b
+    cv::Mat b_;
+    cv::Mat mean_a_;
+    cv::Mat mean_b_;
+    cv::Mat a_full_;
+    cv::Mat b_full_;
+};
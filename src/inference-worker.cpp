@@ -0,0 +1,133 @@
+#include "inference-worker.h"
+#include <obs-module.h>
+#include <util/threading.h>
+#include <utility>
+
+InferenceWorker::InferenceWorker(ModelInference *inference)
+    : inference_(inference)
+    , has_result_(false)
+    , next_sequence_(0)
+    , allocation_count_(0)
+    , stop_(false)
+{
+}
+
+InferenceWorker::~InferenceWorker()
+{
+    Stop();
+}
+
+void InferenceWorker::Start()
+{
+    if (thread_.joinable()) {
+        return;
+    }
+
+    stop_ = false;
+    thread_ = std::thread(&InferenceWorker::ThreadMain, this);
+}
+
+void InferenceWorker::Stop()
+{
+    if (!thread_.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+void InferenceWorker::SubmitJob()
+{
+    jobs_.WriteSlot().sequence = next_sequence_++;
+    jobs_.Publish();
+
+    // The mutex only orders the wake-up against the worker's predicate check;
+    // the frame itself was already handed over lock-free above.
+    { std::lock_guard<std::mutex> lock(wake_mutex_); }
+    wake_.notify_one();
+}
+
+const InferenceResult *InferenceWorker::LatestResult()
+{
+    if (results_.Acquire()) {
+        has_result_ = true;
+    }
+
+    return has_result_ ? &results_.ReadSlot() : nullptr;
+}
+
+void InferenceWorker::ThreadMain()
+{
+    os_set_thread_name("background-filter: inference");
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            wake_.wait(lock, [this] { return stop_ || jobs_.HasFresh(); });
+        }
+
+        if (stop_) {
+            break;
+        }
+
+        if (!jobs_.Acquire()) {
+            continue;
+        }
+
+        InferenceJob &job = jobs_.ReadSlot();
+        InferenceResult &result = results_.WriteSlot();
+
+        try {
+            // Fixed-point masks are smoothed in float, then quantized once
+            const bool smooth = job.edge_smoothing > 0;
+            cv::Mat &mask = job.fixed_point || smooth ? float_mask_ : result.mask;
+            if (!inference_->RunInference(job.image, mask, job.threshold)) {
+                continue;
+            }
+
+            // Smoothing belongs to the mask, so it is done here rather than
+            // on the video thread, guided by the image the mask came from
+            if (smooth) {
+                cv::Mat &smoothed = job.fixed_point ? smooth_mask_ : result.mask;
+                guided_.Apply(job.image, mask, smoothed, job.edge_smoothing);
+                if (job.fixed_point) {
+                    smoothed.convertTo(result.mask, CV_8U, 255.0);
+                }
+            } else if (job.fixed_point) {
+                mask.convertTo(result.mask, CV_8U, 255.0);
+            }
+        } catch (const std::exception &e) {
+            blog(LOG_ERROR, "[Background Filter] Inference worker error: %s", e.what());
+            continue;
+        }
+
+        // After the first run the model's own tensors and mask are sized;
+        // growth means a shape change
+        const uint64_t allocations = inference_->GetAllocationCount();
+        if (job.sequence > 0 && allocations != allocation_count_) {
+            blog(LOG_DEBUG, "[Background Filter] Inference resized its buffers (%llu total)",
+                 (unsigned long long)allocations);
+        }
+        allocation_count_ = allocations;
+
+        job.luma.copyTo(result.luma);
+
+        // Both slots belong to this thread until published, so the image
+        // can change hands without a copy; the job slot gets the result's
+        // old buffer, already the right size for the next sample
+        if (job.return_image) {
+            std::swap(job.image, result.image);
+        } else {
+            result.image.release();
+        }
+        result.region = job.region;
+        result.timestamp = job.timestamp;
+        result.sequence = job.sequence;
+        results_.Publish();
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <opencv2/opencv.hpp>
+#include "guided-filter.h"
+#include "model-inference.h"
+#include "triple-buffer.h"
+
+// Frame handed from the video thread to the inference thread
+struct InferenceJob {
+    cv::Mat image;          // RGB, already at model input size
+    cv::Rect region;        // Part of the frame the image was sampled from
+    cv::Mat luma;           // Luma of the same frame, for mask propagation
+    float threshold;
+    int edge_smoothing;     // Guided filter radius in mask pixels, 0 = off
+    bool fixed_point;       // Hand the mask back as CV_8UC1 (0..255)
+    bool return_image;      // Hand the image back with the mask
+    uint64_t timestamp;     // Timestamp of the frame the image was sampled from
+    uint64_t sequence;
+};
+
+// Mask handed back from the inference thread to the video thread
+struct InferenceResult {
+    cv::Mat mask;           // CV_32FC1 or CV_8UC1, same size as the job image
+    cv::Mat luma;           // The job's luma, kept with the mask it belongs to
+    cv::Mat image;          // The job's image if it asked for it, else empty
+    cv::Rect region;        // Part of the frame the mask covers
+    uint64_t timestamp;     // Frame timestamp of the job it was computed from
+    uint64_t sequence;
+};
+
+// Runs ModelInference on a dedicated thread so filter_video never waits on
+// the model. Frames and masks travel through lock-free triple buffers: the
+// worker always picks up the newest submitted frame and the video thread
+// always composites with the newest finished mask.
+class InferenceWorker {
+public:
+    explicit InferenceWorker(ModelInference *inference);
+    ~InferenceWorker();
+
+    InferenceWorker(const InferenceWorker &) = delete;
+    InferenceWorker &operator=(const InferenceWorker &) = delete;
+
+    // Start / stop the worker thread. Stop() joins and is safe to call twice.
+    void Start();
+    void Stop();
+
+    // Video thread: fill the returned job, then call SubmitJob()
+    InferenceJob &JobSlot() { return jobs_.WriteSlot(); }
+    void SubmitJob();
+
+    // Video thread: newest finished mask, or nullptr before the first one.
+    // The pointer stays valid until the next call.
+    const InferenceResult *LatestResult();
+
+private:
+    void ThreadMain();
+
+    ModelInference *inference_;
+
+    TripleBuffer<InferenceJob> jobs_;
+    TripleBuffer<InferenceResult> results_;
+    bool has_result_;
+    uint64_t next_sequence_;
+    uint64_t allocation_count_;     // Last ModelInference::GetAllocationCount()
+    cv::Mat float_mask_;            // Raw model mask when it is post-processed
+    cv::Mat smooth_mask_;           // Smoothed float mask before quantizing
+    GuidedFilter guided_;
+
+    std::thread thread_;
+    std::atomic<bool> stop_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+};
@@ -0,0 +1,69 @@
+#include "mask-propagator.h"
+#include <algorithm>
+
+namespace {
+
+// Farneback settings for a ~160 pixel image: three pyramid levels reach
+// about 30 pixels of motion, which covers a few frames of a moving subject
+constexpr double kPyramidScale = 0.5;
+constexpr int kLevels = 3;
+constexpr int kWindow = 15;
+constexpr int kIterations = 3;
+constexpr int kPolyN = 5;
+constexpr double kPolySigma = 1.2;
+
+} // namespace
+
+MaskPropagator::MaskPropagator() : drift_(0.0f), generation_(0) {}
+
+void MaskPropagator::BuildMap(cv::Size size, cv::Mat &map)
+{
+    const cv::Mat *source = &flow_;
+    if (flow_.size() != size) {
+        cv::resize(flow_, flow_scaled_, size, 0, 0, cv::INTER_LINEAR);
+        source = &flow_scaled_;
+    }
+
+    const float sx = static_cast<float>(size.width) / flow_.cols;
+    const float sy = static_cast<float>(size.height) / flow_.rows;
+    map.create(size.height, size.width, CV_32FC2);
+
+    for (int y = 0; y < size.height; y++) {
+        const float *in = source->ptr<float>(y);
+        float *out = map.ptr<float>(y);
+        for (int x = 0; x < size.width; x++) {
+            out[x * 2 + 0] = static_cast<float>(x) + in[x * 2 + 0] * sx;
+            out[x * 2 + 1] = static_cast<float>(y) + in[x * 2 + 1] * sy;
+        }
+    }
+}
+
+const cv::Mat &MaskPropagator::Propagate(const cv::Mat &mask, const cv::Mat &reference,
+                                         const cv::Mat &current, bool warp)
+{
+    const cv::Size small((current.cols + 1) / 2, (current.rows + 1) / 2);
+    cv::resize(reference, reference_small_, small, 0, 0, cv::INTER_AREA);
+    cv::resize(current, current_small_, small, 0, 0, cv::INTER_AREA);
+
+    if (!warp) {
+        cv::absdiff(current_small_, reference_small_, residual_);
+        drift_ = static_cast<float>(cv::mean(residual_)[0]);
+        return mask;
+    }
+
+    // Flow from the current frame back to the reference: current(p) is
+    // reference(p + flow(p)), which is exactly what remap samples
+    cv::calcOpticalFlowFarneback(current_small_, reference_small_, flow_, kPyramidScale,
+                                 kLevels, kWindow, kIterations, kPolyN, kPolySigma, 0);
+
+    BuildMap(small, flow_map_);
+    cv::remap(reference_small_, warped_reference_, flow_map_, cv::Mat(), cv::INTER_LINEAR,
+              cv::BORDER_REPLICATE);
+    cv::absdiff(current_small_, warped_reference_, residual_);
+    drift_ = static_cast<float>(cv::mean(residual_)[0]);
+
+    BuildMap(mask.size(), mask_map_);
+    cv::remap(mask, warped_, mask_map_, cv::Mat(), cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+    generation_++;
+    return warped_;
+}
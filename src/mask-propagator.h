@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+
+// Carries a mask forward to frames the model did not see. Dense optical
+// flow is estimated between the luma of the mask's own frame and the
+// current one at half model resolution, and the mask is warped along it.
+// Warping always starts from the model's mask, so errors do not compound
+// from frame to frame. The luma left over after warping measures how far
+// the scene has drifted from what the model saw.
+class MaskPropagator {
+public:
+    MaskPropagator();
+
+    /**
+     * Bring a mask forward to the current frame
+     * @param mask Mask computed from the reference frame (CV_32FC1 or CV_8UC1)
+     * @param reference Model-resolution luma (CV_8UC1) of that frame
+     * @param current Model-resolution luma of the current frame
+     * @param warp Estimate flow and warp the mask; otherwise only measure drift
+     * @return `mask` itself, or the warped copy owned by the propagator
+     */
+    const cv::Mat &Propagate(const cv::Mat &mask, const cv::Mat &reference,
+                             const cv::Mat &current, bool warp);
+
+    // Mean absolute luma difference (0..255) between the current frame and
+    // the reference, after warping when Propagate() warped
+    float Drift() const { return drift_; }
+
+    // Changes whenever Propagate() returns a newly warped mask
+    uint64_t Generation() const { return generation_; }
+
+private:
+    // map(y, x) = (x, y) + flow_ scaled from flow resolution to `size`
+    void BuildMap(cv::Size size, cv::Mat &map);
+
+    cv::Mat reference_small_;
+    cv::Mat current_small_;
+    cv::Mat flow_;
+    cv::Mat flow_scaled_;   // flow_ resized to the mask
+    cv::Mat flow_map_;      // At flow resolution, for the drift check
+    cv::Mat mask_map_;      // At mask resolution
+    cv::Mat warped_reference_;
+    cv::Mat residual_;
+    cv::Mat warped_;
+    float drift_;
+    uint64_t generation_;
+};
@@ -0,0 +1,260 @@
+#include "mask-refiner.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr int kTile = MaskDetail::kTile;
+
+// Rows probed for the boundary per tile row, this far apart plus the last
+constexpr int kProbeStep = 8;
+
+// Coarse alpha strictly between these marks the boundary...
+constexpr float kUncertainLow = 0.1f;
+constexpr float kUncertainHigh = 0.9f;
+
+// ...and beyond these it is a confident sample for the two-level model
+constexpr float kConfidentLow = 0.05f;
+constexpr float kConfidentHigh = 0.95f;
+
+// Frame pixels around a tile the two levels are gathered from
+constexpr int kMargin = 8;
+
+// Confident pixels needed on each side
+constexpr int kMinSamples = 16;
+
+// Luma gap between the levels below which luma cannot tell them apart;
+// the model is fully trusted from twice this
+constexpr float kMinContrast = 12.0f;
+
+// 8-bit luma of a frame pixel, or BT.601 luma of an RGB one
+inline int LumaAt(const MaskRefiner::LumaSource &luma, int x, int y)
+{
+    const uint8_t *px = luma.data + static_cast<size_t>(y) * luma.stride +
+                        static_cast<size_t>(x) * luma.pixel_bytes;
+
+    if (luma.rgb) {
+        return (77 * px[luma.offset[0]] + 150 * px[luma.offset[1]] + 29 * px[luma.offset[2]] +
+                128) >> 8;
+    }
+    if (luma.wide) {
+        uint16_t sample;
+        std::memcpy(&sample, px + luma.offset[0], sizeof(sample));
+        return sample >> luma.shift;
+    }
+    return px[luma.offset[0]];
+}
+
+} // namespace
+
+bool MaskRefiner::SupportsFormat(enum video_format format)
+{
+    return FrameView::Supports(format);
+}
+
+MaskRefiner::LumaSource MaskRefiner::FindLuma(const FrameView &view)
+{
+    const PlaneView &plane = view.Plane(0);
+    LumaSource luma = {};
+    int luma_channels = 0;
+
+    // The first plane holds luma, or all of R, G and B; packed 4:2:2 holds
+    // two luma samples per group, evenly spaced
+    for (int c = plane.blend_channels - 1; c >= 0; c--) {
+        const int component = plane.color_channel[c];
+        luma.offset[component] = c * plane.sample_size;
+        luma_channels += component == 0;
+    }
+    luma.data = plane.data;
+    luma.stride = plane.stride;
+    luma.rgb = view.Rgb();
+    luma.wide = plane.sample_size == 2;
+    luma.shift = view.SampleBits() + view.SampleShift() - 8;
+    luma.pixel_bytes = plane.channels * plane.sample_size / (luma.rgb ? 1 : luma_channels);
+    return luma;
+}
+
+const MaskDetail &MaskRefiner::Refine(const struct obs_source_frame *frame, MaskView &mask,
+                                      const WorkBudget &budget)
+{
+    const FrameView view(frame);
+    const int width = view.Width();
+    const int height = view.Height();
+
+    mask.SetDetail(nullptr);
+    tile_count_ = 0;
+    bytes_read_ = 0;
+    detail_.frame_width = width;
+    detail_.frame_height = height;
+    detail_.columns = 0;
+    detail_.rows = 0;
+    if (mask.Empty() || width == 0 || height == 0 || view.PlaneCount() == 0) {
+        return detail_;
+    }
+    luma_ = FindLuma(view);
+
+    detail_.columns = (width + kTile - 1) / kTile;
+    detail_.rows = (height + kTile - 1) / kTile;
+    detail_.slot.assign(static_cast<size_t>(detail_.columns) * detail_.rows, 0);
+    mask.Prepare(width);
+
+    budget.ForRows(detail_.rows, [&](int stripe, int begin, int end) {
+        for (int grid_row = begin; grid_row < end; grid_row++) {
+            FindTiles(mask, grid_row, stripes_[stripe]);
+        }
+    });
+
+    // Give each flagged cell a slot
+    cells_.clear();
+    for (size_t cell = 0; cell < detail_.slot.size(); cell++) {
+        if (detail_.slot[cell]) {
+            detail_.slot[cell] = static_cast<int>(cells_.size());
+            cells_.push_back(static_cast<int>(cell));
+        } else {
+            detail_.slot[cell] = -1;
+        }
+    }
+
+    const size_t tile_size = static_cast<size_t>(kTile) * kTile;
+    if (mask.FixedPoint()) {
+        detail_.alpha_q.resize(cells_.size() * tile_size);
+    } else {
+        detail_.alpha.resize(cells_.size() * tile_size);
+    }
+
+    // Tiles without a usable model keep the interpolated mask
+    const int count = static_cast<int>(cells_.size());
+    budget.ForRows(count, [&](int stripe, int begin, int end) {
+        for (int slot = begin; slot < end; slot++) {
+            if (!RefineTile(mask, cells_[slot], slot, stripes_[stripe])) {
+                detail_.slot[cells_[slot]] = -1;
+            }
+        }
+    });
+
+    for (int cell : cells_) {
+        tile_count_ += detail_.slot[cell] >= 0;
+    }
+    const int window = kTile + 2 * kMargin;
+    bytes_read_ = static_cast<uint64_t>(count) * window * window * luma_.pixel_bytes;
+    return detail_;
+}
+
+void MaskRefiner::FindTiles(MaskView &mask, int grid_row, StripeScratch &scratch)
+{
+    const int width = detail_.frame_width;
+    const int height = detail_.frame_height;
+    const int top = grid_row * kTile;
+    const int bottom = std::min(top + kTile, height);
+    const bool fixed_point = mask.FixedPoint();
+    const int low_q = static_cast<int>(std::lround(kUncertainLow * 255.0f));
+    const int high_q = static_cast<int>(std::lround(kUncertainHigh * 255.0f));
+    int *cells = detail_.slot.data() + static_cast<size_t>(grid_row) * detail_.columns;
+
+    scratch.alpha.resize(width);
+    scratch.alpha_q.resize(width);
+
+    for (int y = top;; y = std::min(y + kProbeStep, bottom - 1)) {
+        // Spans skip solid runs; only partial ones carry alpha to look at
+        const std::vector<AlphaSpan> &spans =
+                fixed_point
+                        ? mask.SampleSpans(width, height, y, scratch.alpha_q.data(), scratch.rows)
+                        : mask.SampleSpans(width, height, y, scratch.alpha.data(), scratch.rows);
+
+        for (const AlphaSpan &span : spans) {
+            if (span.kind != AlphaSpan::kPartial) {
+                continue;
+            }
+            for (int x = span.begin; x < span.end; x++) {
+                const bool uncertain =
+                        fixed_point ? scratch.alpha_q[x] > low_q && scratch.alpha_q[x] < high_q
+                                    : scratch.alpha[x] > kUncertainLow &&
+                                              scratch.alpha[x] < kUncertainHigh;
+                if (uncertain) {
+                    // The rest of this tile is decided
+                    cells[x / kTile] = 1;
+                    x = (x / kTile + 1) * kTile - 1;
+                }
+            }
+        }
+
+        if (y == bottom - 1) {
+            break;
+        }
+    }
+}
+
+bool MaskRefiner::RefineTile(const MaskView &mask, int cell, int slot, StripeScratch &scratch)
+{
+    const int width = detail_.frame_width;
+    const int height = detail_.frame_height;
+    const int x0 = (cell % detail_.columns) * kTile;
+    const int y0 = (cell / detail_.columns) * kTile;
+    const int x1 = std::min(x0 + kTile, width);
+    const int y1 = std::min(y0 + kTile, height);
+    const int wx0 = std::max(x0 - kMargin, 0);
+    const int wy0 = std::max(y0 - kMargin, 0);
+    const int wx1 = std::min(x1 + kMargin, width);
+    const int wy1 = std::min(y1 + kMargin, height);
+    const int window_width = wx1 - wx0;
+
+    scratch.coarse.resize(static_cast<size_t>(window_width) * (wy1 - wy0));
+    for (int y = wy0; y < wy1; y++) {
+        mask.SampleRange(width, height, y, wx0, wx1,
+                         scratch.coarse.data() + static_cast<size_t>(y - wy0) * window_width,
+                         scratch.rows);
+    }
+
+    // Two-level model from the confident pixels in and around the tile
+    int64_t foreground_sum = 0, background_sum = 0;
+    int foreground = 0, background = 0;
+    for (int y = wy0; y < wy1; y++) {
+        const float *coarse = scratch.coarse.data() + static_cast<size_t>(y - wy0) * window_width;
+        for (int x = wx0; x < wx1; x++) {
+            const float a = coarse[x - wx0];
+            if (a >= kConfidentHigh) {
+                foreground_sum += LumaAt(luma_, x, y);
+                foreground++;
+            } else if (a <= kConfidentLow) {
+                background_sum += LumaAt(luma_, x, y);
+                background++;
+            }
+        }
+    }
+    if (foreground < kMinSamples || background < kMinSamples) {
+        return false;
+    }
+
+    const float foreground_level = static_cast<float>(foreground_sum) / foreground;
+    const float background_level = static_cast<float>(background_sum) / background;
+    const float contrast = foreground_level - background_level;
+    const float trust = std::clamp((std::abs(contrast) - kMinContrast) / kMinContrast, 0.0f, 1.0f);
+    if (trust <= 0.0f) {
+        return false;
+    }
+
+    // Each pixel moves towards the alpha its luma implies, as far as the
+    // coarse mask is unsure of it; solid pixels stay exactly as they were
+    const size_t base = static_cast<size_t>(slot) * kTile * kTile;
+    const bool fixed_point = mask.FixedPoint();
+    for (int y = y0; y < y1; y++) {
+        const float *coarse = scratch.coarse.data() + static_cast<size_t>(y - wy0) * window_width;
+        const size_t out = base + static_cast<size_t>(y - y0) * kTile;
+
+        for (int x = x0; x < x1; x++) {
+            const float a = coarse[x - wx0];
+            const float implied =
+                    std::clamp((LumaAt(luma_, x, y) - background_level) / contrast, 0.0f, 1.0f);
+            const float weight = (1.0f - std::abs(2.0f * a - 1.0f)) * trust;
+            const float refined = a + (implied - a) * weight;
+
+            if (fixed_point) {
+                detail_.alpha_q[out + x - x0] = static_cast<uint8_t>(refined * 255.0f + 0.5f);
+            } else {
+                detail_.alpha[out + x - x0] = refined;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <obs-module.h>
+#include <cstdint>
+#include <vector>
+#include "frame-view.h"
+#include "mask-view.h"
+#include "thread-pool.h"
+
+// Second segmentation stage. The model's mask is interpolated up to the
+// frame, which leaves every edge as soft as a model pixel is wide. Along
+// the uncertain boundary only, frame tiles are re-matted at full
+// resolution from the luma plane: the confident foreground and background
+// around each tile give a local two-level model, and pixels in the
+// transition move towards where their own luma falls between the two. The
+// cost follows the length of the edge, not the frame area.
+class MaskRefiner {
+public:
+    static bool SupportsFormat(enum video_format format);
+
+    /**
+     * Re-matte the boundary tiles of a frame
+     * @param frame Frame the mask belongs to, before anything is blended
+     * @param mask Coarse mask; any detail it carried is dropped
+     * @param budget Threads the tiles may use
+     * @return Tiles to lay over the mask with MaskView::SetDetail
+     */
+    const MaskDetail &Refine(const struct obs_source_frame *frame, MaskView &mask,
+                             const WorkBudget &budget);
+
+    // Tiles refined and frame bytes read by the last Refine()
+    int TileCount() const { return tile_count_; }
+    uint64_t BytesRead() const { return bytes_read_; }
+
+    // Where a frame's luma sits in its first plane, or its R, G and B
+    struct LumaSource {
+        const uint8_t *data;
+        size_t stride;
+        int pixel_bytes;    // From one pixel to the next
+        int offset[3];      // Bytes into a pixel: Y, or R, G, B
+        int shift;          // Down to 8 bits, for 16-bit samples
+        bool rgb;
+        bool wide;          // 16-bit samples
+    };
+
+private:
+    static LumaSource FindLuma(const FrameView &view);
+
+    struct StripeScratch {
+        MaskView::RowScratch rows;
+        std::vector<float> alpha;       // One frame row, for the boundary probes
+        std::vector<uint8_t> alpha_q;
+        std::vector<float> coarse;      // Tile window of the interpolated mask
+    };
+
+    // Flag grid cells whose probe rows cross the boundary
+    void FindTiles(MaskView &mask, int grid_row, StripeScratch &scratch);
+
+    // Matte one tile into its slot; false if it has no usable two-level model
+    bool RefineTile(const MaskView &mask, int cell, int slot, StripeScratch &scratch);
+
+    StripeScratch stripes_[ThreadPool::kMaxStripes];
+    MaskDetail detail_;
+    std::vector<int> cells_;            // Grid cell of each slot
+    LumaSource luma_ = {};              // Of the frame being refined
+    int tile_count_ = 0;
+    uint64_t bytes_read_ = 0;
+};
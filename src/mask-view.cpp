@@ -0,0 +1,402 @@
+#include "mask-view.h"
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+MaskView::MaskView()
+    : mask_(nullptr)
+    , sequence_(0)
+    , region_(0.0f, 0.0f, 1.0f, 1.0f)
+    , detail_(nullptr)
+    , next_map_(0)
+{
+}
+
+void MaskView::Reset(const cv::Mat *mask, uint64_t sequence, const cv::Rect2f &region)
+{
+    if (mask == mask_ && sequence == sequence_ && region == region_) {
+        return;
+    }
+
+    mask_ = mask;
+    sequence_ = sequence;
+    region_ = region;
+}
+
+void MaskView::Prepare(int width)
+{
+    const int mask_width = mask_->cols;
+    const float left = region_.x;
+    const float right = region_.x + region_.width;
+
+    for (const RowMap &map : maps_) {
+        if (map.width == width && map.mask_width == mask_width && map.left == left &&
+            map.right == right) {
+            return;
+        }
+    }
+
+    RowMap &map = maps_[next_map_];
+    next_map_ = (next_map_ + 1) % 2;
+
+    map.width = width;
+    map.mask_width = mask_width;
+    map.left = left;
+    map.right = right;
+    map.x0.resize(width);
+    map.x1.resize(width);
+    map.weight.resize(width);
+    map.weight_q.resize(width);
+    map.first.resize(mask_width + 1);
+
+    // Only columns inside the region get taps; the rest are background
+    const float first_x = left * width;
+    const float last_x = right * width;
+    map.begin = std::clamp(static_cast<int>(std::lround(first_x)), 0, width);
+    map.end = std::clamp(static_cast<int>(std::lround(last_x)), map.begin, width);
+
+    const float ratio = static_cast<float>(mask_width) / (last_x - first_x);
+    for (int x = map.begin; x < map.end; x++) {
+        const float fx = std::clamp((x + 0.5f - first_x) * ratio - 0.5f, 0.0f,
+                                    static_cast<float>(mask_width - 1));
+        map.x0[x] = static_cast<int>(fx);
+        map.x1[x] = std::min(map.x0[x] + 1, mask_width - 1);
+        map.weight[x] = fx - map.x0[x];
+        map.weight_q[x] = static_cast<uint16_t>(map.weight[x] * 256.0f + 0.5f);
+    }
+
+    // x0 never decreases, so one sweep gives the inverse mapping
+    for (int m = 0, x = map.begin; m <= mask_width; m++) {
+        while (x < map.end && map.x0[x] < m) {
+            x++;
+        }
+        map.first[m] = x;
+    }
+}
+
+const MaskView::RowMap &MaskView::MapFor(int width) const
+{
+    const int mask_width = mask_->cols;
+    const RowMap &map = maps_[0];
+    return map.width == width && map.mask_width == mask_width && map.left == region_.x &&
+                   map.right == region_.x + region_.width
+           ? map
+           : maps_[1];
+}
+
+bool MaskView::MaskRow(int height, int row, float &fy) const
+{
+    const float top = region_.y * height;
+    const float bottom = (region_.y + region_.height) * height;
+    if (row < std::lround(top) || row >= std::lround(bottom)) {
+        return false;
+    }
+
+    const int mask_height = mask_->rows;
+    fy = std::clamp((row + 0.5f - top) * mask_height / (bottom - top) - 0.5f, 0.0f,
+                    static_cast<float>(mask_height - 1));
+    return true;
+}
+
+bool MaskView::Column(int height, int row, RowScratch &scratch) const
+{
+    const int mask_height = mask_->rows;
+    const int mask_width = mask_->cols;
+
+    float fy;
+    if (!MaskRow(height, row, fy)) {
+        return false;
+    }
+    const int y0 = static_cast<int>(fy);
+    const int y1 = std::min(y0 + 1, mask_height - 1);
+    const float wy = fy - y0;
+    const float *r0 = mask_->ptr<float>(y0);
+    const float *r1 = mask_->ptr<float>(y1);
+
+    scratch.column.resize(mask_width);
+    for (int x = 0; x < mask_width; x++) {
+        scratch.column[x] = r0[x] + (r1[x] - r0[x]) * wy;
+    }
+    return true;
+}
+
+bool MaskView::ColumnQ(int height, int row, RowScratch &scratch) const
+{
+    const int mask_height = mask_->rows;
+    const int mask_width = mask_->cols;
+
+    float fy;
+    if (!MaskRow(height, row, fy)) {
+        return false;
+    }
+    const int y0 = static_cast<int>(fy);
+    const int y1 = std::min(y0 + 1, mask_height - 1);
+    const int wy = static_cast<int>((fy - y0) * 256.0f + 0.5f);
+    const uint8_t *r0 = mask_->ptr<uint8_t>(y0);
+    const uint8_t *r1 = mask_->ptr<uint8_t>(y1);
+
+    // Column values carry 8 extra fraction bits (at most 255 * 256)
+    scratch.column_q.resize(mask_width);
+    for (int x = 0; x < mask_width; x++) {
+        scratch.column_q[x] = static_cast<uint16_t>(r0[x] * (256 - wy) + r1[x] * wy);
+    }
+    return true;
+}
+
+void MaskView::Interpolate(const RowMap &map, const float *column, int begin, int end,
+                           float *alpha)
+{
+    for (int x = begin; x < end; x++) {
+        const float a = column[map.x0[x]];
+        alpha[x] = a + (column[map.x1[x]] - a) * map.weight[x];
+    }
+}
+
+void MaskView::Interpolate(const RowMap &map, const uint16_t *column, int begin, int end,
+                           uint8_t *alpha)
+{
+    // Drops the column's 8 fraction bits and the weight's 8 with rounding
+    for (int x = begin; x < end; x++) {
+        const int w = map.weight_q[x];
+        alpha[x] = static_cast<uint8_t>(
+                (column[map.x0[x]] * (256 - w) + column[map.x1[x]] * w + 32768) >> 16);
+    }
+}
+
+void MaskView::SampleRow(int width, int height, int row, float *alpha,
+                         RowScratch &scratch) const
+{
+    // Vertical interpolation at mask resolution first (a few hundred taps),
+    // then horizontal interpolation out to the plane width
+    const RowMap &map = MapFor(width);
+    if (Column(height, row, scratch)) {
+        std::fill(alpha, alpha + map.begin, 0.0f);
+        Interpolate(map, scratch.column.data(), map.begin, map.end, alpha);
+        std::fill(alpha + map.end, alpha + width, 0.0f);
+    } else {
+        std::fill(alpha, alpha + width, 0.0f);
+    }
+
+    if (detail_) {
+        ApplyDetail(width, height, row, alpha, nullptr, scratch);
+    }
+}
+
+void MaskView::SampleRow(int width, int height, int row, uint8_t *alpha,
+                         RowScratch &scratch) const
+{
+    const RowMap &map = MapFor(width);
+    if (ColumnQ(height, row, scratch)) {
+        std::fill(alpha, alpha + map.begin, uint8_t(0));
+        Interpolate(map, scratch.column_q.data(), map.begin, map.end, alpha);
+        std::fill(alpha + map.end, alpha + width, uint8_t(0));
+    } else {
+        std::fill(alpha, alpha + width, uint8_t(0));
+    }
+
+    if (detail_) {
+        ApplyDetail(width, height, row, alpha, nullptr, scratch);
+    }
+}
+
+void MaskView::SampleRange(int width, int height, int row, int begin, int end, float *alpha,
+                           RowScratch &scratch) const
+{
+    const RowMap &map = MapFor(width);
+    const int inner_begin = std::clamp(begin, map.begin, map.end);
+    const int inner_end = std::clamp(end, inner_begin, map.end);
+    std::fill(alpha, alpha + (end - begin), 0.0f);
+
+    // Interpolate writes by plane column, so go through a row-sized buffer
+    if (FixedPoint()) {
+        if (ColumnQ(height, row, scratch)) {
+            scratch.range_q.resize(width);
+            Interpolate(map, scratch.column_q.data(), inner_begin, inner_end,
+                        scratch.range_q.data());
+            for (int x = inner_begin; x < inner_end; x++) {
+                alpha[x - begin] = scratch.range_q[x] * (1.0f / 255.0f);
+            }
+        }
+    } else if (Column(height, row, scratch)) {
+        scratch.range.resize(width);
+        Interpolate(map, scratch.column.data(), inner_begin, inner_end, scratch.range.data());
+        std::copy(scratch.range.begin() + inner_begin, scratch.range.begin() + inner_end,
+                  alpha + (inner_begin - begin));
+    }
+}
+
+template <typename T>
+void MaskView::ApplyDetail(int width, int height, int row, T *alpha,
+                           std::vector<AlphaSpan> *spans, RowScratch &scratch) const
+{
+    const MaskDetail &detail = *detail_;
+    const int tile = MaskDetail::kTile;
+    if (detail.columns == 0) {
+        return;
+    }
+
+    // Subsampled planes take every other frame pixel of the tile
+    const int scale_x = detail.frame_width > width ? 2 : 1;
+    const int scale_y = detail.frame_height > height ? 2 : 1;
+    const int frame_y = std::min(row * scale_y, detail.frame_height - 1);
+    const int grid_row = frame_y / tile;
+    const int tile_y = frame_y - grid_row * tile;
+
+    const T *tiles;
+    if constexpr (std::is_same_v<T, float>) {
+        tiles = detail.alpha.data();
+    } else {
+        tiles = detail.alpha_q.data();
+    }
+
+    std::vector<AlphaSpan> &ranges = scratch.detail;
+    ranges.clear();
+    for (int c = 0; c < detail.columns; c++) {
+        const int slot = detail.slot[grid_row * detail.columns + c];
+        if (slot < 0) {
+            continue;
+        }
+
+        const int begin = c * tile / scale_x;
+        const int end = std::min((c + 1) * tile / scale_x, width);
+        const T *source = tiles + (static_cast<size_t>(slot) * tile + tile_y) * tile;
+        for (int x = begin; x < end; x++) {
+            alpha[x] = source[std::min(x * scale_x, detail.frame_width - 1) - c * tile];
+        }
+
+        if (!ranges.empty() && ranges.back().end == begin) {
+            ranges.back().end = end;
+        } else {
+            ranges.push_back({begin, end, AlphaSpan::kPartial});
+        }
+    }
+
+    if (spans && !ranges.empty()) {
+        SplitSpans(*spans, ranges, scratch.split);
+    }
+}
+
+void MaskView::SplitSpans(std::vector<AlphaSpan> &spans, const std::vector<AlphaSpan> &ranges,
+                          std::vector<AlphaSpan> &out)
+{
+    out.clear();
+    auto push = [&](int begin, int end, AlphaSpan::Kind kind) {
+        if (!out.empty() && out.back().kind == kind && out.back().end == begin) {
+            out.back().end = end;
+        } else {
+            out.push_back({begin, end, kind});
+        }
+    };
+
+    size_t r = 0;
+    for (const AlphaSpan &span : spans) {
+        for (int x = span.begin; x < span.end;) {
+            while (r < ranges.size() && ranges[r].end <= x) {
+                r++;
+            }
+
+            int end;
+            if (r < ranges.size() && ranges[r].begin <= x) {
+                end = std::min(span.end, ranges[r].end);
+                push(x, end, AlphaSpan::kPartial);
+            } else {
+                end = r < ranges.size() ? std::min(span.end, ranges[r].begin) : span.end;
+                push(x, end, span.kind);
+            }
+            x = end;
+        }
+    }
+
+    spans.swap(out);
+}
+
+template <typename T>
+void MaskView::BuildSpans(const RowMap &map, const T *column, T background, T foreground,
+                          std::vector<AlphaSpan> &spans)
+{
+    const int mask_width = map.mask_width;
+    auto kind_of = [&](T value) {
+        return value <= background ? AlphaSpan::kBackground
+             : value >= foreground ? AlphaSpan::kForeground
+                                   : AlphaSpan::kPartial;
+    };
+
+    spans.clear();
+    if (map.begin > 0) {
+        spans.push_back({0, map.begin, AlphaSpan::kBackground});
+    }
+    int covered = map.begin;
+
+    for (int m = 0; m < mask_width;) {
+        const AlphaSpan::Kind kind = kind_of(column[m]);
+        int end = m + 1;
+        while (end < mask_width && kind_of(column[end]) == kind) {
+            end++;
+        }
+
+        // Plane pixels whose two taps both fall inside [m, end)
+        if (kind != AlphaSpan::kPartial) {
+            const int begin_x = map.first[m];
+            const int end_x = end == mask_width ? map.end : map.first[end - 1];
+            if (end_x > begin_x) {
+                if (begin_x > covered) {
+                    spans.push_back({covered, begin_x, AlphaSpan::kPartial});
+                }
+                spans.push_back({begin_x, end_x, kind});
+                covered = end_x;
+            }
+        }
+        m = end;
+    }
+
+    if (covered < map.end) {
+        spans.push_back({covered, map.end, AlphaSpan::kPartial});
+    }
+    if (map.end < map.width) {
+        spans.push_back({map.end, map.width, AlphaSpan::kBackground});
+    }
+}
+
+const std::vector<AlphaSpan> &MaskView::SampleSpans(int width, int height, int row,
+                                                    float *alpha, RowScratch &scratch) const
+{
+    const RowMap &map = MapFor(width);
+    if (Column(height, row, scratch)) {
+        BuildSpans<float>(map, scratch.column.data(), kSolidEpsilon, 1.0f - kSolidEpsilon,
+                          scratch.spans);
+        for (const AlphaSpan &span : scratch.spans) {
+            if (span.kind == AlphaSpan::kPartial) {
+                Interpolate(map, scratch.column.data(), span.begin, span.end, alpha);
+            }
+        }
+    } else {
+        scratch.spans.assign(1, {0, width, AlphaSpan::kBackground});
+    }
+
+    if (detail_) {
+        ApplyDetail(width, height, row, alpha, &scratch.spans, scratch);
+    }
+    return scratch.spans;
+}
+
+const std::vector<AlphaSpan> &MaskView::SampleSpans(int width, int height, int row,
+                                                    uint8_t *alpha, RowScratch &scratch) const
+{
+    // Fixed-point columns are exactly 0 or 255 * 256 where the mask is solid
+    const RowMap &map = MapFor(width);
+    if (ColumnQ(height, row, scratch)) {
+        BuildSpans<uint16_t>(map, scratch.column_q.data(), 0, 255 * 256, scratch.spans);
+        for (const AlphaSpan &span : scratch.spans) {
+            if (span.kind == AlphaSpan::kPartial) {
+                Interpolate(map, scratch.column_q.data(), span.begin, span.end, alpha);
+            }
+        }
+    } else {
+        scratch.spans.assign(1, {0, width, AlphaSpan::kBackground});
+    }
+
+    if (detail_) {
+        ApplyDetail(width, height, row, alpha, &scratch.spans, scratch);
+    }
+    return scratch.spans;
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// Run of plane pixels in one row that share an alpha class
+struct AlphaSpan {
+    enum Kind : uint8_t {
+        kBackground,    // alpha 0: take the background as is
+        kForeground,    // alpha 1: leave the pixel alone
+        kPartial,       // anything between: blend
+    };
+
+    int begin;
+    int end;
+    Kind kind;
+};
+
+// Full-resolution alpha for the frame tiles a MaskRefiner re-matted. Inside
+// a refined tile it replaces the interpolated mask.
+struct MaskDetail {
+    static constexpr int kTile = 32;
+
+    int frame_width = 0;
+    int frame_height = 0;
+    int columns = 0;                    // Tile grid size
+    int rows = 0;
+    std::vector<int> slot;              // Per grid cell: tile slot, or -1
+    std::vector<float> alpha;           // kTile * kTile per slot, float masks
+    std::vector<uint8_t> alpha_q;       // The same for fixed-point masks
+};
+
+// Segmentation mask as the model produced it (model resolution). Consumers
+// pull bilinearly interpolated alpha one output row at a time, so no
+// frame-sized mask is ever materialized. After Prepare() the sampling calls
+// only touch the caller's RowScratch, so row stripes can run in parallel.
+//
+// The mask may cover only a region of the frame (the model was fed a crop);
+// everything outside that region is background. Refined tiles (MaskDetail)
+// can be laid over it.
+class MaskView {
+public:
+    // Per-thread working memory for the sampling calls
+    struct RowScratch {
+        std::vector<float> column;
+        std::vector<uint16_t> column_q;     // Row lerp scaled by 256
+        std::vector<AlphaSpan> spans;
+        std::vector<AlphaSpan> detail;      // Refined column ranges of a row
+        std::vector<AlphaSpan> split;
+        std::vector<float> range;           // SampleRange output by plane column
+        std::vector<uint8_t> range_q;
+    };
+
+    // Float alpha this close to 0 or 1 counts as solid; treating it as exact
+    // moves a pixel by at most half a level
+    static constexpr float kSolidEpsilon = 1.0f / 512.0f;
+
+    MaskView();
+
+    // Point the view at a new model-resolution mask (not copied; it must
+    // outlive the view's use). `region` is the part of the frame the mask
+    // covers, as fractions of the frame size. Repeating the same sequence
+    // and region is a no-op.
+    void Reset(const cv::Mat *mask, uint64_t sequence,
+               const cv::Rect2f &region = cv::Rect2f(0.0f, 0.0f, 1.0f, 1.0f));
+
+    bool Empty() const { return !mask_ || mask_->empty(); }
+
+    // Lay refined tiles over the mask, or nullptr for none (not copied)
+    void SetDetail(const MaskDetail *detail) { detail_ = detail; }
+
+    // Model-resolution mask, CV_32FC1 or (fixed point) CV_8UC1
+    const cv::Mat &Source() const { return *mask_; }
+
+    // True for CV_8UC1 masks, which must be read with the uint8_t SampleRow
+    bool FixedPoint() const { return mask_->type() == CV_8UC1; }
+
+    /**
+     * Build the horizontal taps for a plane width. Must be called before
+     * sampling rows of that width; up to two widths are kept at a time.
+     * @param width Plane width
+     */
+    void Prepare(int width);
+
+    /**
+     * Interpolate one row of alpha for a plane covering the whole frame
+     * @param width Plane width (the mask is stretched to cover it)
+     * @param height Plane height
+     * @param row Plane row to produce
+     * @param alpha Receives `width` values in [0, 1]
+     * @param scratch Working memory of the calling thread
+     */
+    void SampleRow(int width, int height, int row, float *alpha, RowScratch &scratch) const;
+
+    /**
+     * Fixed-point SampleRow for CV_8UC1 masks, using 8-bit weights
+     * @param width Plane width (the mask is stretched to cover it)
+     * @param height Plane height
+     * @param row Plane row to produce
+     * @param alpha Receives `width` values in 0..255
+     * @param scratch Working memory of the calling thread
+     */
+    void SampleRow(int width, int height, int row, uint8_t *alpha, RowScratch &scratch) const;
+
+    /**
+     * Split one plane row into background, foreground and partial spans.
+     * Runs are found at mask resolution, and alpha is only interpolated
+     * inside the partial spans; elsewhere `alpha` is left untouched.
+     * @param width Plane width
+     * @param height Plane height
+     * @param row Plane row to produce
+     * @param alpha Receives alpha for the partial spans (float or 0..255
+     *              variant, matching FixedPoint())
+     * @param scratch Working memory of the calling thread
+     * @return Spans covering [0, width) in order, held in `scratch`
+     */
+    const std::vector<AlphaSpan> &SampleSpans(int width, int height, int row, float *alpha,
+                                              RowScratch &scratch) const;
+    const std::vector<AlphaSpan> &SampleSpans(int width, int height, int row, uint8_t *alpha,
+                                              RowScratch &scratch) const;
+
+    /**
+     * Interpolate part of one row of the mask itself, without any detail
+     * @param width Plane width (the mask is stretched to cover it)
+     * @param height Plane height
+     * @param row Plane row to produce
+     * @param begin First plane column
+     * @param end One past the last plane column
+     * @param alpha Receives `end - begin` values in [0, 1] for either mask type
+     * @param scratch Working memory of the calling thread
+     */
+    void SampleRange(int width, int height, int row, int begin, int end, float *alpha,
+                     RowScratch &scratch) const;
+
+private:
+    // Horizontal bilinear taps for one plane width
+    struct RowMap {
+        int width = 0;
+        int mask_width = 0;
+        float left = 0.0f;                  // Region the map was built for
+        float right = 0.0f;
+        int begin = 0;                      // Plane columns the mask covers
+        int end = 0;
+        std::vector<int> x0;
+        std::vector<int> x1;
+        std::vector<float> weight;
+        std::vector<uint16_t> weight_q;     // weight * 256
+        std::vector<int> first;             // First x with x0 >= m, per mask column m
+    };
+
+    const RowMap &MapFor(int width) const;
+
+    // Vertical lerp of two mask rows into scratch.column / column_q; false
+    // (and nothing written) for rows outside the mask's region
+    bool Column(int height, int row, RowScratch &scratch) const;
+    bool ColumnQ(int height, int row, RowScratch &scratch) const;
+
+    // Mask row coordinate for a plane row, or false outside the region
+    bool MaskRow(int height, int row, float &fy) const;
+
+    // Horizontal lerp out of a column row for plane pixels [begin, end)
+    static void Interpolate(const RowMap &map, const float *column, int begin, int end,
+                            float *alpha);
+    static void Interpolate(const RowMap &map, const uint16_t *column, int begin, int end,
+                            uint8_t *alpha);
+
+    // Write refined tiles crossing a plane row into alpha, and turn their
+    // columns into partial spans when `spans` is given
+    template <typename T>
+    void ApplyDetail(int width, int height, int row, T *alpha, std::vector<AlphaSpan> *spans,
+                     RowScratch &scratch) const;
+
+    // Re-cut ordered spans so every range in `ranges` is partial
+    static void SplitSpans(std::vector<AlphaSpan> &spans, const std::vector<AlphaSpan> &ranges,
+                           std::vector<AlphaSpan> &out);
+
+    // Turn per-column classes (see AlphaSpan::Kind) into plane spans
+    template <typename T>
+    static void BuildSpans(const RowMap &map, const T *column, T background, T foreground,
+                           std::vector<AlphaSpan> &spans);
+
+    const cv::Mat *mask_;
+    uint64_t sequence_;
+    cv::Rect2f region_;
+    const MaskDetail *detail_;
+
+    // Luma and chroma planes differ in width, so keep one map for each
+    RowMap maps_[2];
+    int next_map_;
+};
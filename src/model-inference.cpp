@@ -1,19 +1,123 @@
 #include "model-inference.h"
 #include "security-utils.h"
 #include <obs-module.h>
+#include <algorithm>
+#include <cmath>
 #include <filesystem>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MODEL_INFERENCE_SSE2
+#endif
+
 // ONNX Runtime includes (conditional compilation if not available)
 #ifdef HAVE_ONNXRUNTIME
 #include <onnxruntime_cxx_api.h>
+#else
+// Never created without ONNX Runtime; they only need to be complete for
+// the unique_ptr members to be destroyed
+namespace Ort {
+    class Env {};
+    class Session {};
+    class SessionOptions {};
+    struct Value {};
+    class MemoryInfo {};
+    struct IoBinding {};
+    struct RunOptions {};
+}
 #endif
 
 namespace fs = std::filesystem;
 
+namespace {
+
+// ImageNet statistics folded into a single multiply-add per element:
+// (v / 255 - mean) / std == v * scale + bias
+const float kImageNetMean[3] = {0.485f, 0.456f, 0.406f};
+const float kImageNetStd[3] = {0.229f, 0.224f, 0.225f};
+
+void ScaleBiasRow(const float *src, float *dst, int count, float scale, float bias)
+{
+    int x = 0;
+#ifdef MODEL_INFERENCE_SSE2
+    const __m128 s = _mm_set1_ps(scale);
+    const __m128 b = _mm_set1_ps(bias);
+    for (; x + 8 <= count; x += 8) {
+        __m128 v0 = _mm_loadu_ps(src + x);
+        __m128 v1 = _mm_loadu_ps(src + x + 4);
+        _mm_storeu_ps(dst + x, _mm_add_ps(_mm_mul_ps(v0, s), b));
+        _mm_storeu_ps(dst + x + 4, _mm_add_ps(_mm_mul_ps(v1, s), b));
+    }
+#endif
+    for (; x < count; x++) {
+        dst[x] = src[x] * scale + bias;
+    }
+}
+
+// Sigmoid followed by the threshold (values at or below it become 0).
+// exp() is evaluated as 2^(x * log2 e), splitting off the nearest integer
+// power and approximating the remaining 2^f, |f| <= 0.5, with a degree-5
+// polynomial; the sigmoid stays within ~1e-6 of std::exp.
+void SigmoidThreshold(const float *src, float *dst, int count, float threshold)
+{
+    int i = 0;
+#ifdef MODEL_INFERENCE_SSE2
+    const __m128 t = _mm_set1_ps(threshold);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 lo = _mm_set1_ps(-87.0f);
+    const __m128 hi = _mm_set1_ps(87.0f);
+    const __m128 log2e = _mm_set1_ps(1.44269504f);
+    const __m128 c1 = _mm_set1_ps(6.9314718e-1f);
+    const __m128 c2 = _mm_set1_ps(2.4022650e-1f);
+    const __m128 c3 = _mm_set1_ps(5.5504109e-2f);
+    const __m128 c4 = _mm_set1_ps(9.6181291e-3f);
+    const __m128 c5 = _mm_set1_ps(1.3333558e-3f);
+    
+    for (; i + 4 <= count; i += 4) {
+        // e = exp(-x)
+        __m128 x = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(src + i));
+        x = _mm_min_ps(_mm_max_ps(x, lo), hi);
+        __m128 y = _mm_mul_ps(x, log2e);
+        
+        // Round to nearest so the fraction stays in [-0.5, 0.5]
+        __m128i yi = _mm_cvtps_epi32(y);
+        __m128 yf = _mm_cvtepi32_ps(yi);
+        
+        __m128 f = _mm_sub_ps(y, yf);
+        __m128 p = _mm_add_ps(_mm_mul_ps(c5, f), c4);
+        p = _mm_add_ps(_mm_mul_ps(p, f), c3);
+        p = _mm_add_ps(_mm_mul_ps(p, f), c2);
+        p = _mm_add_ps(_mm_mul_ps(p, f), c1);
+        p = _mm_add_ps(_mm_mul_ps(p, f), one);
+        
+        __m128i bits = _mm_slli_epi32(_mm_add_epi32(yi, _mm_set1_epi32(127)), 23);
+        __m128 e = _mm_mul_ps(p, _mm_castsi128_ps(bits));
+        
+        __m128 s = _mm_div_ps(one, _mm_add_ps(one, e));
+        _mm_storeu_ps(dst + i, _mm_and_ps(s, _mm_cmpgt_ps(s, t)));
+    }
+#endif
+    for (; i < count; i++) {
+        const float value = 1.0f / (1.0f + std::exp(-src[i]));
+        dst[i] = value > threshold ? value : 0.0f;
+    }
+}
+
+#ifndef HAVE_ONNXRUNTIME
+// Stand-in model output without ONNX Runtime: sigmoid(20) is foreground
+constexpr float kMockLogit = 20.0f;
+#endif
+
+} // namespace
+
 ModelInference::ModelInference()
     : model_loaded_(false)
     , input_height_(320)
     , input_width_(320)
+    , output_height_(320)
+    , output_width_(320)
+    , resize_src_width_(0)
+    , allocation_count_(0)
 {
 #ifdef HAVE_ONNXRUNTIME
     try {
@@ -41,6 +145,9 @@ ModelInference::ModelInference()
     }
 #else
     blog(LOG_WARNING, "[Background Filter] ONNX Runtime not available. Model inference disabled.");
+    
+    // The stand-in model in RunInference works on the default shape
+    AllocateBuffers();
 #endif
 }
 
@@ -104,7 +211,7 @@ bool ModelInference::LoadModel(const std::string &model_path)
             auto tensor_info = input_type_info.GetTensorTypeAndShapeInfo();
             input_shape_ = tensor_info.GetShape();
             
-            if (input_shape_.size() >= 4) {
+            if (input_shape_.size() >= 4 && input_shape_[2] > 0 && input_shape_[3] > 0) {
                 input_height_ = static_cast<int>(input_shape_[2]);
                 input_width_ = static_cast<int>(input_shape_[3]);
             }
@@ -119,6 +226,16 @@ bool ModelInference::LoadModel(const std::string &model_path)
             output_shape_ = tensor_info.GetShape();
         }
         
+        // Dynamic output dimensions follow the input (U2-Net style 1x1xHxW)
+        output_height_ = input_height_;
+        output_width_ = input_width_;
+        if (output_shape_.size() >= 4 && output_shape_[2] > 0 && output_shape_[3] > 0) {
+            output_height_ = static_cast<int>(output_shape_[2]);
+            output_width_ = static_cast<int>(output_shape_[3]);
+        }
+        
+        AllocateBuffers();
+        
         model_loaded_ = true;
         blog(LOG_INFO, "[Background Filter] Model loaded: input size %dx%d", 
              input_width_, input_height_);
@@ -137,61 +254,19 @@ bool ModelInference::LoadModel(const std::string &model_path)
 bool ModelInference::RunInference(const cv::Mat &input_frame, cv::Mat &output_mask, float threshold)
 {
 #ifdef HAVE_ONNXRUNTIME
-    if (!model_loaded_ || !session_) {
+    if (!model_loaded_ || !session_ || input_frame.type() != CV_8UC3) {
         return false;
     }
     
     try {
-        // Preprocess input
-        cv::Mat preprocessed = Preprocess(input_frame);
-        
-        // Prepare input tensor
-        std::vector<float> input_tensor_values(preprocessed.total() * preprocessed.channels());
+        // Preprocess straight into the persistent input tensor
+        Preprocess(input_frame, input_tensor_.data());
         
-        // Convert to CHW format (Channels, Height, Width)
-        std::vector<cv::Mat> channels(3);
-        cv::split(preprocessed, channels);
+        // Run against the pre-bound tensors; outputs land in output_tensor_
+        session_->Run(*run_options_, *io_binding_);
         
-        size_t single_channel_size = preprocessed.total();
-        for (int c = 0; c < 3; c++) {
-            std::memcpy(
-                input_tensor_values.data() + c * single_channel_size,
-                channels[c].data,
-                single_channel_size * sizeof(float)
-            );
-        }
-        
-        // Create input tensor
-        std::vector<int64_t> input_dims = {1, 3, input_height_, input_width_};
-        
-        auto input_tensor = Ort::Value::CreateTensor<float>(
-            *memory_info_,
-            input_tensor_values.data(),
-            input_tensor_values.size(),
-            input_dims.data(),
-            input_dims.size()
-        );
-        
-        // Run inference
-        auto output_tensors = session_->Run(
-            Ort::RunOptions{nullptr},
-            input_names_.data(),
-            &input_tensor,
-            1,
-            output_names_.data(),
-            1
-        );
-        
-        // Get output
-        float* output_data = output_tensors[0].GetTensorMutableData<float>();
-        auto output_shape = output_tensors[0].GetTensorTypeAndShapeInfo().GetShape();
-        
-        int output_height = static_cast<int>(output_shape[2]);
-        int output_width = static_cast<int>(output_shape[3]);
-        
-        // Postprocess
-        output_mask = Postprocess(output_data, output_height, output_width, 
-                                   input_frame.rows, input_frame.cols, threshold);
+        Postprocess(output_tensor_.data(), output_height_, output_width_, threshold,
+                    output_mask);
         
         return true;
         
@@ -200,52 +275,138 @@ bool ModelInference::RunInference(const cv::Mat &input_frame, cv::Mat &output_ma
         return false;
     }
 #else
-    // Fallback: create a simple mock mask for testing without ONNX Runtime
-    output_mask = cv::Mat::ones(input_frame.rows, input_frame.cols, CV_32FC1);
+    // Without ONNX Runtime an all-foreground output stands in for the
+    // model, so everything around it runs, and allocates, as usual
+    if (input_frame.type() != CV_8UC3) {
+        return false;
+    }
+    
+    Preprocess(input_frame, input_tensor_.data());
+    std::fill(output_tensor_.data(), output_tensor_.data() + output_tensor_.size(), kMockLogit);
+    Postprocess(output_tensor_.data(), output_height_, output_width_, threshold, output_mask);
     return true;
 #endif
 }
 
-cv::Mat ModelInference::Preprocess(const cv::Mat &input)
+void ModelInference::Preprocess(const cv::Mat &input, float *tensor)
 {
-    // Resize to model input size
-    cv::Mat resized;
-    cv::resize(input, resized, cv::Size(input_width_, input_height_));
+    const int dst_width = input_width_;
+    const int dst_height = input_height_;
+    const int src_width = input.cols;
+    const int src_height = input.rows;
+    const size_t plane_size = static_cast<size_t>(dst_width) * dst_height;
+    const bool same_size = src_width == dst_width && src_height == dst_height;
     
-    // Convert to float and normalize [0, 1]
-    cv::Mat normalized;
-    resized.convertTo(normalized, CV_32FC3, 1.0 / 255.0);
+    float scale[3], bias[3];
+    for (int c = 0; c < 3; c++) {
+        scale[c] = 1.0f / (255.0f * kImageNetStd[c]);
+        bias[c] = -kImageNetMean[c] / kImageNetStd[c];
+    }
     
-    // Normalize with ImageNet mean and std
-    cv::Scalar mean(0.485, 0.456, 0.406);
-    cv::Scalar std(0.229, 0.224, 0.225);
+    // Horizontal bilinear map, rebuilt only when the source width changes
+    if (!same_size && resize_src_width_ != src_width) {
+        const float ratio = static_cast<float>(src_width) / dst_width;
+        resize_x_.resize(static_cast<size_t>(dst_width) * 2);
+        resize_wx_.resize(dst_width);
+        
+        for (int x = 0; x < dst_width; x++) {
+            const float fx = std::max((x + 0.5f) * ratio - 0.5f, 0.0f);
+            const int x0 = std::min(static_cast<int>(fx), src_width - 1);
+            const int x1 = std::min(x0 + 1, src_width - 1);
+            resize_x_[x * 2] = x0 * 3;
+            resize_x_[x * 2 + 1] = x1 * 3;
+            resize_wx_[x] = fx - x0;
+        }
+        resize_src_width_ = src_width;
+    }
     
-    cv::subtract(normalized, mean, normalized);
-    cv::divide(normalized, std, normalized);
+    float *rows[3] = {
+        row_buffer_.data(),
+        row_buffer_.data() + dst_width,
+        row_buffer_.data() + dst_width * 2,
+    };
     
-    return normalized;
+    for (int y = 0; y < dst_height; y++) {
+        // Deinterleave (and resample) one row into L1-resident channel rows...
+        if (same_size) {
+            const uint8_t *src = input.ptr<uint8_t>(y);
+            for (int x = 0; x < dst_width; x++) {
+                rows[0][x] = src[x * 3 + 0];
+                rows[1][x] = src[x * 3 + 1];
+                rows[2][x] = src[x * 3 + 2];
+            }
+        } else {
+            const float fy = std::max((y + 0.5f) * src_height / dst_height - 0.5f, 0.0f);
+            const int y0 = std::min(static_cast<int>(fy), src_height - 1);
+            const int y1 = std::min(y0 + 1, src_height - 1);
+            const float wy = fy - y0;
+            const uint8_t *s0 = input.ptr<uint8_t>(y0);
+            const uint8_t *s1 = input.ptr<uint8_t>(y1);
+            
+            for (int x = 0; x < dst_width; x++) {
+                const int x0 = resize_x_[x * 2];
+                const int x1 = resize_x_[x * 2 + 1];
+                const float wx = resize_wx_[x];
+                
+                for (int c = 0; c < 3; c++) {
+                    const float top = s0[x0 + c] + (s0[x1 + c] - s0[x0 + c]) * wx;
+                    const float bottom = s1[x0 + c] + (s1[x1 + c] - s1[x0 + c]) * wx;
+                    rows[c][x] = top + (bottom - top) * wy;
+                }
+            }
+        }
+        
+        // ...then normalize it straight into its CHW position in the tensor
+        for (int c = 0; c < 3; c++) {
+            ScaleBiasRow(rows[c], tensor + c * plane_size + static_cast<size_t>(y) * dst_width,
+                         dst_width, scale[c], bias[c]);
+        }
+    }
+}
+
+void ModelInference::AllocateBuffers()
+{
+    // Preprocessing and the session write straight into these every frame
+    input_tensor_.Resize(static_cast<size_t>(3) * input_height_ * input_width_);
+    output_tensor_.Resize(static_cast<size_t>(output_height_) * output_width_);
+    row_buffer_.Resize(static_cast<size_t>(3) * input_width_);
+    resize_src_width_ = 0;
+    BindBuffers();
 }
 
-cv::Mat ModelInference::Postprocess(float *output_data, int output_height, int output_width,
-                                     int target_height, int target_width, float threshold)
+void ModelInference::BindBuffers()
 {
-    // Create mask from output
-    cv::Mat mask(output_height, output_width, CV_32FC1);
+#ifdef HAVE_ONNXRUNTIME
+    const int64_t input_dims[4] = {1, 3, input_height_, input_width_};
+    const int64_t output_dims[4] = {1, 1, output_height_, output_width_};
     
-    // Apply sigmoid and threshold
-    for (int i = 0; i < output_height * output_width; i++) {
-        float value = output_data[i];
-        // Sigmoid activation
-        value = 1.0f / (1.0f + std::exp(-value));
-        // Apply threshold
-        mask.at<float>(i) = value > threshold ? value : 0.0f;
-    }
+    input_value_ = std::make_unique<Ort::Value>(Ort::Value::CreateTensor<float>(
+        *memory_info_, input_tensor_.data(), input_tensor_.size(), input_dims, 4));
+    output_value_ = std::make_unique<Ort::Value>(Ort::Value::CreateTensor<float>(
+        *memory_info_, output_tensor_.data(), output_tensor_.size(), output_dims, 4));
     
-    // Resize to target size
-    cv::Mat resized_mask;
-    cv::resize(mask, resized_mask, cv::Size(target_width, target_height), 0, 0, cv::INTER_LINEAR);
+    io_binding_ = std::make_unique<Ort::IoBinding>(*session_);
+    io_binding_->BindInput(input_names_[0], *input_value_);
+    io_binding_->BindOutput(output_names_[0], *output_value_);
+    
+    run_options_ = std::make_unique<Ort::RunOptions>();
+    allocation_count_++;
+#endif
+}
+
+void ModelInference::Postprocess(const float *output_data, int output_height, int output_width,
+                                 float threshold, cv::Mat &output_mask)
+{
+    // The mask stays at model resolution; upsampling is left to whoever
+    // consumes it. create() is a no-op while the size stays the same.
+    const uint8_t *previous = output_mask.data;
+    output_mask.create(output_height, output_width, CV_32FC1);
+    if (output_mask.data != previous) {
+        allocation_count_++;
+    }
     
-    return resized_mask;
+    SigmoidThreshold(output_data, output_mask.ptr<float>(), output_height * output_width,
+                     threshold);
 }
 
 void ModelInference::GetInputShape(int &height, int &width) const
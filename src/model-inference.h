@@ -1,8 +1,11 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 #include <opencv2/opencv.hpp>
+#include "aligned-buffer.h"
 
 // Forward declarations for ONNX Runtime
 namespace Ort {
@@ -11,6 +14,8 @@ namespace Ort {
     class SessionOptions;
     struct Value;
     class MemoryInfo;
+    struct IoBinding;
+    struct RunOptions;
 }
 
 class ModelInference {
@@ -21,7 +26,7 @@ public:
     // Load ONNX model
     bool LoadModel(const std::string &model_path);
     
-    // Run inference on a frame
+    // Run inference on an RGB frame; the mask comes back at model resolution
     bool RunInference(const cv::Mat &input_frame, cv::Mat &output_mask, float threshold);
     
     // Check if model is loaded
@@ -30,13 +35,25 @@ public:
     // Get model info
     void GetInputShape(int &height, int &width) const;
     
+    // Times this class has (re)sized its own tensors and mask; stays flat
+    // once the model and frame shapes are stable. Allocations inside ONNX
+    // Runtime or OpenCV are not seen here (tests/model-inference-test.cpp
+    // counts every heap allocation instead).
+    uint64_t GetAllocationCount() const { return allocation_count_; }
+    
 private:
-    // Preprocess input image
-    cv::Mat Preprocess(const cv::Mat &input);
+    // Resize, normalize and transpose an RGB image into an NCHW tensor in one pass
+    void Preprocess(const cv::Mat &input, float *tensor);
+    
+    // Postprocess output into a model-resolution mask
+    void Postprocess(const float *output_data, int output_height, int output_width,
+                     float threshold, cv::Mat &output_mask);
+    
+    // Size the persistent tensors for the current model shape and bind them
+    void AllocateBuffers();
     
-    // Postprocess output to get mask
-    cv::Mat Postprocess(float *output_data, int output_height, int output_width, 
-                        int target_height, int target_width, float threshold);
+    // Bind the persistent input/output tensors to the session once per model
+    void BindBuffers();
     
     // ONNX Runtime components
     std::unique_ptr<Ort::Env> env_;
@@ -44,6 +61,13 @@ private:
     std::unique_ptr<Ort::SessionOptions> session_options_;
     std::unique_ptr<Ort::MemoryInfo> memory_info_;
     
+    // Pre-bound tensors wrapping input_tensor_ / output_tensor_, reused by
+    // every Run so steady-state inference allocates nothing
+    std::unique_ptr<Ort::Value> input_value_;
+    std::unique_ptr<Ort::Value> output_value_;
+    std::unique_ptr<Ort::IoBinding> io_binding_;
+    std::unique_ptr<Ort::RunOptions> run_options_;
+    
     // Model configuration
     bool model_loaded_;
     int input_height_;
@@ -52,5 +76,17 @@ private:
     std::vector<const char*> output_names_;
     std::vector<int64_t> input_shape_;
     std::vector<int64_t> output_shape_;
+    
+    // Persistent preprocessing buffers, sized once per model
+    AlignedBuffer<float> input_tensor_;     // 1 x 3 x H x W
+    AlignedBuffer<float> output_tensor_;    // 1 x 1 x H x W
+    int output_height_;
+    int output_width_;
+    AlignedBuffer<float> row_buffer_;       // One deinterleaved row per channel
+    std::vector<int> resize_x_;             // Byte offsets of the two source pixels
+    std::vector<float> resize_wx_;          // Horizontal bilinear weights
+    int resize_src_width_;
+    
+    uint64_t allocation_count_;
 };
 
@@ -1,5 +1,7 @@
 #include <obs-module.h>
 #include "background-filter.h"
+#include "blend-kernels.h"
+#include "thread-pool.h"
 
 OBS_DECLARE_MODULE()
 OBS_MODULE_USE_DEFAULT_LOCALE("obs-background-filter", "en-US")
@@ -11,6 +13,11 @@ MODULE_EXPORT const char *obs_module_description(void)
 
 bool obs_module_load(void)
 {
+    BlendKernelSelect::Init();
+    
+    // Shared by every filter instance; leave room for OBS's own threads
+    ThreadPool::StartGlobal(0.5f);
+
     struct obs_source_info background_filter_info = {};
     
     background_filter_info.id = "background_removal_filter";
@@ -33,6 +40,7 @@ bool obs_module_load(void)
 
 void obs_module_unload(void)
 {
+    ThreadPool::StopGlobal();
     blog(LOG_INFO, "OBS Background Filter plugin unloaded");
 }
 
@@ -0,0 +1,166 @@
+#include "roi-tracker.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Mask alpha above this counts as subject when fitting the box
+constexpr float kSubjectAlpha = 0.5f;
+
+// Margin added on every side of the subject, as a fraction of its size.
+// The current region is kept while the subject plus half of it still fits.
+constexpr float kPadding = 0.2f;
+
+// A region covering more than this fraction of the frame saves nothing
+constexpr float kMaxCoverage = 0.7f;
+
+// A region more than this many times the area it needs is re-fitted
+constexpr int kRefitArea = 2;
+
+// Subject this close (in mask pixels) to an inner region edge is cut off
+constexpr int kEdgeMargin = 1;
+
+// Tracked inferences between whole-frame looks
+constexpr int kWholeFrameEvery = 30;
+
+// Bounding box of the subject pixels in mask coordinates, empty if none
+cv::Rect SubjectBox(const cv::Mat &mask)
+{
+    const bool fixed_point = mask.type() == CV_8UC1;
+    const int threshold_q = static_cast<int>(kSubjectAlpha * 255.0f);
+    int x0 = mask.cols, x1 = -1, y0 = mask.rows, y1 = -1;
+
+    for (int y = 0; y < mask.rows; y++) {
+        int first = mask.cols, last = -1;
+        for (int x = 0; x < mask.cols; x++) {
+            const bool subject = fixed_point ? mask.ptr<uint8_t>(y)[x] > threshold_q
+                                             : mask.ptr<float>(y)[x] > kSubjectAlpha;
+            if (subject) {
+                first = std::min(first, x);
+                last = x;
+            }
+        }
+
+        if (last >= 0) {
+            x0 = std::min(x0, first);
+            x1 = std::max(x1, last);
+            y0 = std::min(y0, y);
+            y1 = y;
+        }
+    }
+
+    return x1 < 0 ? cv::Rect() : cv::Rect(x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+}
+
+} // namespace
+
+RoiTracker::RoiTracker() : frame_width_(0), frame_height_(0), tracked_updates_(0), tracking_(false)
+{
+}
+
+void RoiTracker::Reset()
+{
+    tracking_ = false;
+    tracked_updates_ = 0;
+}
+
+cv::Rect RoiTracker::Region(int frame_width, int frame_height) const
+{
+    if (!tracking_ || frame_width != frame_width_ || frame_height != frame_height_) {
+        return cv::Rect(0, 0, frame_width, frame_height);
+    }
+    return region_;
+}
+
+void RoiTracker::Update(const cv::Mat &mask, const cv::Rect &region, int frame_width,
+                        int frame_height, cv::Size model_size)
+{
+    if (frame_width != frame_width_ || frame_height != frame_height_) {
+        Reset();
+        frame_width_ = frame_width;
+        frame_height_ = frame_height;
+    }
+
+    // A mask from before a frame size change says nothing about this frame
+    if (mask.empty() || region.x + region.width > frame_width ||
+        region.y + region.height > frame_height) {
+        tracking_ = false;
+        return;
+    }
+
+    // Subject lost
+    const cv::Rect box = SubjectBox(mask);
+    if (box.empty()) {
+        tracking_ = false;
+        return;
+    }
+
+    // Subject reaching an edge of the region that is not an edge of the
+    // frame may continue outside it
+    if ((region.x > 0 && box.x <= kEdgeMargin) || (region.y > 0 && box.y <= kEdgeMargin) ||
+        (region.x + region.width < frame_width &&
+         box.x + box.width >= mask.cols - kEdgeMargin) ||
+        (region.y + region.height < frame_height &&
+         box.y + box.height >= mask.rows - kEdgeMargin)) {
+        tracking_ = false;
+        return;
+    }
+
+    if (tracking_ && ++tracked_updates_ >= kWholeFrameEvery) {
+        tracking_ = false;
+        return;
+    }
+
+    // Subject box in frame pixels
+    const float scale_x = static_cast<float>(region.width) / mask.cols;
+    const float scale_y = static_cast<float>(region.height) / mask.rows;
+    const float subject_width = box.width * scale_x;
+    const float subject_height = box.height * scale_y;
+    const float center_x = region.x + (box.x + box.width * 0.5f) * scale_x;
+    const float center_y = region.y + (box.y + box.height * 0.5f) * scale_y;
+    float width = subject_width * (1.0f + 2.0f * kPadding);
+    float height = subject_height * (1.0f + 2.0f * kPadding);
+
+    // Widen to the model's aspect ratio so the crop is not stretched, and
+    // never below the model size, where the crop would only be upsampled
+    const float aspect = static_cast<float>(model_size.width) / model_size.height;
+    height = std::max({height, width / aspect, static_cast<float>(model_size.height)});
+    width = height * aspect;
+
+    width = std::min(width, static_cast<float>(frame_width));
+    height = std::min(height, static_cast<float>(frame_height));
+    const float left = std::clamp(center_x - width * 0.5f, 0.0f, frame_width - width);
+    const float top = std::clamp(center_y - height * 0.5f, 0.0f, frame_height - height);
+
+    // Even offsets keep 4:2:0 chroma aligned with the region
+    const int x = static_cast<int>(left) & ~1;
+    const int y = static_cast<int>(top) & ~1;
+    const int right = std::min(static_cast<int>(std::ceil(left + width)), frame_width);
+    const int bottom = std::min(static_cast<int>(std::ceil(top + height)), frame_height);
+    const cv::Rect fitted(x, y, right - x, bottom - y);
+
+    if (fitted.area() > kMaxCoverage * frame_width * frame_height) {
+        tracking_ = false;
+        return;
+    }
+
+    // Keep the current region while it still holds the subject with some
+    // margin and is not much larger than needed, so the model input stays
+    // put while the subject shifts a little
+    const float keep_width = subject_width * (1.0f + kPadding);
+    const float keep_height = subject_height * (1.0f + kPadding);
+    const cv::Rect keep(static_cast<int>(center_x - keep_width * 0.5f),
+                        static_cast<int>(center_y - keep_height * 0.5f),
+                        static_cast<int>(keep_width), static_cast<int>(keep_height));
+    const cv::Rect frame(0, 0, frame_width, frame_height);
+    if (tracking_ && (keep & frame & region_) == (keep & frame) &&
+        fitted.area() * kRefitArea > region_.area()) {
+        return;
+    }
+
+    if (!tracking_) {
+        tracked_updates_ = 0;
+    }
+    region_ = fitted;
+    tracking_ = true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+// Keeps the model looking at the subject instead of the whole frame. The
+// foreground bounding box of each new mask, padded and widened to the
+// model's aspect ratio, becomes the region the following frames are
+// sampled from, so the subject covers more model pixels at the same
+// inference cost. The region is only re-fitted when the subject leaves it
+// or it has become much larger than needed. The whole frame is sampled
+// again when the subject is lost or cut off by the region's edge, and
+// every so often so that anyone entering the frame is noticed.
+class RoiTracker {
+public:
+    RoiTracker();
+
+    // Go back to sampling the whole frame
+    void Reset();
+
+    /**
+     * Region of the frame to sample next
+     * @param frame_width Frame width
+     * @param frame_height Frame height
+     * @return Rectangle in frame pixels with even offsets; the whole frame
+     *         when not tracking
+     */
+    cv::Rect Region(int frame_width, int frame_height) const;
+
+    /**
+     * Fit the region to a new mask
+     * @param mask Model mask (CV_32FC1 or CV_8UC1)
+     * @param region Frame region the mask was computed from
+     * @param frame_width Frame width
+     * @param frame_height Frame height
+     * @param model_size Model input size, whose aspect ratio the region takes
+     */
+    void Update(const cv::Mat &mask, const cv::Rect &region, int frame_width, int frame_height,
+                cv::Size model_size);
+
+    bool Tracking() const { return tracking_; }
+
+private:
+    cv::Rect region_;
+    int frame_width_;
+    int frame_height_;
+    int tracked_updates_;   // Since the last whole-frame look
+    bool tracking_;
+};
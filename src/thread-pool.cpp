@@ -0,0 +1,205 @@
+#include "thread-pool.h"
+#include <obs-module.h>
+#include <util/threading.h>
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+
+namespace {
+
+std::unique_ptr<ThreadPool> global_pool;
+
+} // namespace
+
+ThreadPool::ThreadPool(int threads) : enqueue_pos_(0), dequeue_pos_(0), queued_(0), stop_(false)
+{
+    for (size_t i = 0; i < kQueueSize; i++) {
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    threads = std::clamp(threads, 0, kMaxStripes - 1);
+    for (int i = 0; i < threads; i++) {
+        threads_.emplace_back(&ThreadPool::ThreadMain, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+
+    for (std::thread &thread : threads_) {
+        thread.join();
+    }
+}
+
+bool ThreadPool::Push(const Task &task)
+{
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+
+    for (;;) {
+        Cell &cell = cells_[pos & (kQueueSize - 1)];
+        const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+        if (diff == 0) {
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                cell.task = task;
+                cell.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;   // Full
+        } else {
+            pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool ThreadPool::Pop(Task &task)
+{
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+
+    for (;;) {
+        Cell &cell = cells_[pos & (kQueueSize - 1)];
+        const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+
+        if (diff == 0) {
+            if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                task = cell.task;
+                cell.sequence.store(pos + kQueueSize, std::memory_order_release);
+                queued_.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;   // Empty
+        } else {
+            pos = dequeue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void ThreadPool::RunStripe(Batch &batch, TaskFn fn, void *context, int stripe, int begin,
+                           int end)
+{
+    // Once a stripe has failed the call is lost anyway; skip the rest
+    if (batch.failed.load(std::memory_order_relaxed)) {
+        return;
+    }
+    try {
+        fn(context, stripe, begin, end);
+    } catch (...) {
+        if (!batch.failed.exchange(true, std::memory_order_acq_rel)) {
+            batch.error = std::current_exception();
+        }
+    }
+}
+
+void ThreadPool::Execute(const Task &task)
+{
+    RunStripe(*task.batch, task.fn, task.context, task.stripe, task.begin, task.end);
+    task.batch->pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void ThreadPool::Run(int count, int stripes, TaskFn fn, void *context)
+{
+    stripes = std::min({stripes, count, Threads() + 1, kMaxStripes});
+    if (stripes <= 1) {
+        if (count > 0) {
+            fn(context, 0, 0, count);
+        }
+        return;
+    }
+
+    auto bound = [count, stripes](int s) {
+        return static_cast<int>(static_cast<int64_t>(count) * s / stripes);
+    };
+
+    // Stripe 0 stays on this thread; the rest go to the queue
+    Batch batch;
+    batch.pending.store(stripes - 1, std::memory_order_relaxed);
+    batch.failed.store(false, std::memory_order_relaxed);
+    for (int s = 1; s < stripes; s++) {
+        const Task task = {fn, context, s, bound(s), bound(s + 1), &batch};
+        queued_.fetch_add(1, std::memory_order_relaxed);
+        if (!Push(task)) {
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            Execute(task);
+        }
+    }
+
+    // As in InferenceWorker, the mutex only orders the wake-up against the
+    // workers' predicate check
+    { std::lock_guard<std::mutex> lock(wake_mutex_); }
+    wake_.notify_all();
+
+    RunStripe(batch, fn, context, 0, 0, bound(1));
+
+    // Help out rather than block until our stripes are done. Even after a
+    // failure every task still points at this frame, so all of them are
+    // waited for before the exception is passed on.
+    while (batch.pending.load(std::memory_order_acquire) > 0) {
+        Task task;
+        if (Pop(task)) {
+            Execute(task);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    if (batch.error) {
+        std::rethrow_exception(batch.error);
+    }
+}
+
+void ThreadPool::ThreadMain(int index)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "background-filter: pool %d", index);
+    os_set_thread_name(name);
+
+    for (;;) {
+        Task task;
+        if (Pop(task)) {
+            Execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_.wait(lock, [this] {
+            return stop_ || queued_.load(std::memory_order_relaxed) > 0;
+        });
+        if (stop_) {
+            break;
+        }
+    }
+}
+
+ThreadPool *ThreadPool::Global()
+{
+    return global_pool.get();
+}
+
+void ThreadPool::StartGlobal(float budget)
+{
+    if (global_pool) {
+        return;
+    }
+
+    // The caller of each ParallelFor works too, hence the -1
+    const int hardware = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+    const int threads = std::max(static_cast<int>(hardware * budget) - 1, 0);
+    global_pool = std::make_unique<ThreadPool>(threads);
+
+    blog(LOG_INFO, "[Background Filter] Thread pool: %d workers (%d hardware threads)",
+         global_pool->Threads(), hardware);
+}
+
+void ThreadPool::StopGlobal()
+{
+    global_pool.reset();
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Worker threads shared by every filter instance for row-striped pixel
+// work (sampling, blur, blend). Work is handed out through a bounded
+// lock-free MPMC queue; the submitting thread runs a stripe itself and
+// helps drain the queue until its stripes are done, so a call never just
+// sits waiting.
+class ThreadPool {
+public:
+    // Upper bound on stripes per call, and so on per-stripe scratch
+    static constexpr int kMaxStripes = 16;
+
+    explicit ThreadPool(int threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Worker threads, not counting callers
+    int Threads() const { return static_cast<int>(threads_.size()); }
+
+    /**
+     * Split [0, count) into contiguous stripes and run fn(stripe, begin, end)
+     * on each; returns once all of them have finished
+     * @param count Number of rows (or other items) to cover
+     * @param stripes Most stripes to cut, capped by kMaxStripes and the pool
+     * @param fn Callable taking (int stripe, int begin, int end)
+     */
+    template <typename Fn>
+    void ParallelFor(int count, int stripes, Fn &&fn)
+    {
+        using Callable = std::remove_reference_t<Fn>;
+        Run(count, stripes,
+            [](void *context, int stripe, int begin, int end) {
+                (*static_cast<Callable *>(context))(stripe, begin, end);
+            },
+            &fn);
+    }
+
+    /**
+     * Plugin-wide pool, created by obs_module_load()
+     * @return The pool, or nullptr before Start / after Stop
+     */
+    static ThreadPool *Global();
+
+    /**
+     * Create the plugin-wide pool
+     * @param budget Fraction of the machine's hardware threads to use
+     */
+    static void StartGlobal(float budget);
+    static void StopGlobal();
+
+private:
+    using TaskFn = void (*)(void *context, int stripe, int begin, int end);
+
+    // One Run() call, on the caller's stack. It is only left once pending
+    // reaches zero, so no task outlives it.
+    struct Batch {
+        std::atomic<int> pending;
+        std::atomic<bool> failed;
+        std::exception_ptr error;       // First exception, written by whoever set failed
+    };
+
+    struct Task {
+        TaskFn fn;
+        void *context;
+        int stripe;
+        int begin;
+        int end;
+        Batch *batch;
+    };
+
+    // Bounded MPMC queue (Vyukov); each cell's sequence number says whether
+    // it is ready to be written or read in the current lap
+    struct Cell {
+        std::atomic<size_t> sequence;
+        Task task;
+    };
+    static constexpr size_t kQueueSize = 256;
+
+    bool Push(const Task &task);
+    bool Pop(Task &task);
+
+    // Run a stripe, keeping any exception in its batch for the caller;
+    // nothing may escape onto a pool thread
+    static void RunStripe(Batch &batch, TaskFn fn, void *context, int stripe, int begin,
+                          int end);
+    static void Execute(const Task &task);
+
+    void Run(int count, int stripes, TaskFn fn, void *context);
+    void ThreadMain(int index);
+
+    Cell cells_[kQueueSize];
+    alignas(64) std::atomic<size_t> enqueue_pos_;
+    alignas(64) std::atomic<size_t> dequeue_pos_;
+    std::atomic<int> queued_;
+
+    std::vector<std::thread> threads_;
+    std::atomic<bool> stop_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+};
+
+// How much of a pool one piece of work may use
+struct WorkBudget {
+    ThreadPool *pool = nullptr;     // nullptr runs everything on the caller
+    int stripes = 1;
+
+    /**
+     * Run fn(stripe, begin, end) over [0, rows), in parallel if allowed
+     * @param rows Rows to cover
+     * @param fn Callable taking (int stripe, int begin, int end)
+     */
+    template <typename Fn>
+    void ForRows(int rows, Fn &&fn) const
+    {
+        if (pool && stripes > 1) {
+            pool->ParallelFor(rows, stripes, fn);
+        } else if (rows > 0) {
+            fn(0, 0, rows);
+        }
+    }
+};
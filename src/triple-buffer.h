@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single-producer / single-consumer triple buffer.
+//
+// The producer owns a back slot it can fill at leisure, the consumer owns a
+// front slot it can read at leisure, and the third slot sits in between and is
+// swapped atomically. Publishing never waits for the consumer and acquiring
+// never waits for the producer; a consumer that falls behind simply skips
+// straight to the newest value.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : shared_(1), back_(0), front_(2) {}
+
+    TripleBuffer(const TripleBuffer &) = delete;
+    TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+    // Producer side: slot to fill before calling Publish()
+    T &WriteSlot() { return slots_[back_]; }
+
+    // Producer side: hand the filled slot to the consumer
+    void Publish()
+    {
+        back_ = shared_.exchange(back_ | kFresh, std::memory_order_acq_rel) & kIndexMask;
+    }
+
+    // Consumer side: swap in the newest published slot, if any.
+    // Returns false when nothing new was published since the last call.
+    bool Acquire()
+    {
+        if (!(shared_.load(std::memory_order_acquire) & kFresh)) {
+            return false;
+        }
+        front_ = shared_.exchange(front_, std::memory_order_acq_rel) & kIndexMask;
+        return true;
+    }
+
+    // Consumer side: most recently acquired slot
+    T &ReadSlot() { return slots_[front_]; }
+
+    // Either side: whether a published slot is waiting to be acquired
+    bool HasFresh() const { return shared_.load(std::memory_order_acquire) & kFresh; }
+
+private:
+    static constexpr uint8_t kIndexMask = 0x3;
+    static constexpr uint8_t kFresh = 0x4;
+
+    T slots_[3];
+    std::atomic<uint8_t> shared_;
+    uint8_t back_;
+    uint8_t front_;
+};
@@ -0,0 +1,261 @@
+// Every blend kernel table must produce the same bytes as the scalar one:
+// the compositor picks a table per CPU, and a frame must not look different
+// on another machine. Each table the CPU can run is compared against scalar
+// over every kernel, the interleaved layouts the compositor uses and a
+// spread of widths that exercises both the vector bodies and the tails.
+//
+// The fixed-point (_q) kernels are also held to the float ones: with alpha
+// quantized to 8 bits they may be off by at most one level, and only
+// rarely.
+
+#include "blend-kernels.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Layout {
+    int channels;
+    int blend_channels;
+};
+
+// Planar (Y800, I420 planes), interleaved chroma (NV12 UV, YUY2) and RGBA
+constexpr Layout kLayouts[] = {{1, 1}, {2, 2}, {4, 3}};
+
+constexpr int kMaxWidth = 1923;
+
+std::vector<int> Widths()
+{
+    std::vector<int> widths;
+    for (int w = 1; w <= 67; w++) {
+        widths.push_back(w);
+    }
+    for (int w : {127, 128, 129, 255, 256, 257, 1279, 1280, 1281, 1919, 1920, 1921, kMaxWidth}) {
+        widths.push_back(w);
+    }
+    return widths;
+}
+
+// Mostly random, with the endpoints and exact halves that exercise rounding
+float RandomAlpha(std::mt19937 &rng)
+{
+    switch (rng() % 8) {
+    case 0:
+        return 0.0f;
+    case 1:
+        return 1.0f;
+    case 2:
+        return 0.5f;
+    default:
+        return std::uniform_real_distribution<float>(0.0f, 1.0f)(rng);
+    }
+}
+
+struct Inputs {
+    std::vector<uint8_t> row, background;
+    std::vector<uint16_t> row16, background16;
+    std::vector<float> alpha;
+    std::vector<uint8_t> alpha_q;
+    uint8_t color[4];
+    uint16_t color16[4];
+
+    explicit Inputs(std::mt19937 &rng)
+        : row(kMaxWidth * 4), background(kMaxWidth * 4), row16(kMaxWidth * 4),
+          background16(kMaxWidth * 4), alpha(kMaxWidth), alpha_q(kMaxWidth)
+    {
+        for (size_t i = 0; i < row.size(); i++) {
+            row[i] = static_cast<uint8_t>(rng());
+            background[i] = static_cast<uint8_t>(rng());
+            // 10-bit samples, either low- or high-bit aligned
+            const uint16_t sample = static_cast<uint16_t>(rng() & 0x3ff);
+            row16[i] = (i & 1) ? static_cast<uint16_t>(sample << 6) : sample;
+            background16[i] = static_cast<uint16_t>(rng() & 0xffff);
+        }
+        for (int x = 0; x < kMaxWidth; x++) {
+            alpha[x] = RandomAlpha(rng);
+            alpha_q[x] = static_cast<uint8_t>(rng());
+        }
+        for (int c = 0; c < 4; c++) {
+            color[c] = static_cast<uint8_t>(rng());
+            color16[c] = static_cast<uint16_t>(rng());
+        }
+    }
+};
+
+int failures = 0;
+
+template <typename T>
+bool Same(const char *table, const char *kernel, const Layout &layout, int width,
+          const std::vector<T> &expected, const std::vector<T> &actual)
+{
+    if (expected == actual) {
+        return true;
+    }
+    size_t i = 0;
+    while (expected[i] == actual[i]) {
+        i++;
+    }
+    std::printf("FAIL: %s %s (%d/%d channels, width %d) differs from scalar at sample %zu: "
+                "%d vs %d\n", table, kernel, layout.blend_channels, layout.channels, width, i,
+                static_cast<int>(actual[i]), static_cast<int>(expected[i]));
+    failures++;
+    return false;
+}
+
+void Compare(const BlendKernels &k, const Inputs &in)
+{
+    const BlendKernels &s = kBlendKernelsScalar;
+
+    for (const Layout &layout : kLayouts) {
+        const int ch = layout.channels;
+        const int bc = layout.blend_channels;
+        for (int width : Widths()) {
+            const size_t n = static_cast<size_t>(width) * ch;
+            std::vector<uint8_t> a(in.row.begin(), in.row.begin() + n);
+            std::vector<uint8_t> b = a;
+            std::vector<uint16_t> a16(in.row16.begin(), in.row16.begin() + n);
+            std::vector<uint16_t> b16 = a16;
+
+            s.blend_color(a.data(), in.alpha.data(), width, ch, bc, in.color);
+            k.blend_color(b.data(), in.alpha.data(), width, ch, bc, in.color);
+            Same(k.name, "blend_color", layout, width, a, b);
+
+            s.blend_background(a.data(), in.background.data(), in.alpha.data(), width, ch, bc);
+            k.blend_background(b.data(), in.background.data(), in.alpha.data(), width, ch, bc);
+            Same(k.name, "blend_background", layout, width, a, b);
+
+            s.blend_color_q(a.data(), in.alpha_q.data(), width, ch, bc, in.color);
+            k.blend_color_q(b.data(), in.alpha_q.data(), width, ch, bc, in.color);
+            Same(k.name, "blend_color_q", layout, width, a, b);
+
+            s.blend_background_q(a.data(), in.background.data(), in.alpha_q.data(), width, ch,
+                                 bc);
+            k.blend_background_q(b.data(), in.background.data(), in.alpha_q.data(), width, ch,
+                                 bc);
+            Same(k.name, "blend_background_q", layout, width, a, b);
+
+            s.blend_color16(a16.data(), in.alpha.data(), width, ch, bc, in.color16);
+            k.blend_color16(b16.data(), in.alpha.data(), width, ch, bc, in.color16);
+            Same(k.name, "blend_color16", layout, width, a16, b16);
+
+            s.blend_background16(a16.data(), in.background16.data(), in.alpha.data(), width, ch,
+                                 bc);
+            k.blend_background16(b16.data(), in.background16.data(), in.alpha.data(), width, ch,
+                                 bc);
+            Same(k.name, "blend_background16", layout, width, a16, b16);
+
+            s.blend_color16_q(a16.data(), in.alpha_q.data(), width, ch, bc, in.color16);
+            k.blend_color16_q(b16.data(), in.alpha_q.data(), width, ch, bc, in.color16);
+            Same(k.name, "blend_color16_q", layout, width, a16, b16);
+
+            s.blend_background16_q(a16.data(), in.background16.data(), in.alpha_q.data(), width,
+                                   ch, bc);
+            k.blend_background16_q(b16.data(), in.background16.data(), in.alpha_q.data(), width,
+                                   ch, bc);
+            Same(k.name, "blend_background16_q", layout, width, a16, b16);
+
+            // Alpha lands in a plane (stride 1) or an RGBA/BGRA pixel (stride 4)
+            if (ch == 1 || ch == 4) {
+                std::vector<uint8_t> sa = in.row;
+                std::vector<uint8_t> ka = in.row;
+                s.store_alpha(sa.data(), in.alpha.data(), width, ch);
+                k.store_alpha(ka.data(), in.alpha.data(), width, ch);
+                Same(k.name, "store_alpha", layout, width, sa, ka);
+            }
+        }
+    }
+}
+
+constexpr int kMaxQuantizedError = 1;
+constexpr double kMaxMeanQuantizedError = 0.1;
+
+// blend_color/blend_background against their _q versions fed the same
+// alpha rounded to 8 bits, at every width
+void CompareQuantized(const BlendKernels &k, const Inputs &in)
+{
+    std::vector<float> alpha(kMaxWidth);
+    for (int x = 0; x < kMaxWidth; x++) {
+        alpha[x] = in.alpha_q[x] / 255.0f;
+    }
+
+    for (const Layout &layout : kLayouts) {
+        const int ch = layout.channels;
+        const int bc = layout.blend_channels;
+        int max_error = 0;
+        uint64_t error_sum = 0;
+        uint64_t samples = 0;
+        for (int width = 1; width <= kMaxWidth; width++) {
+            const size_t n = static_cast<size_t>(width) * ch;
+            for (int background = 0; background < 2; background++) {
+                std::vector<uint8_t> f(in.row.begin(), in.row.begin() + n);
+                std::vector<uint8_t> q = f;
+                if (background) {
+                    k.blend_background(f.data(), in.background.data(), alpha.data(), width, ch,
+                                       bc);
+                    k.blend_background_q(q.data(), in.background.data(), in.alpha_q.data(),
+                                         width, ch, bc);
+                } else {
+                    k.blend_color(f.data(), alpha.data(), width, ch, bc, in.color);
+                    k.blend_color_q(q.data(), in.alpha_q.data(), width, ch, bc, in.color);
+                }
+                for (size_t i = 0; i < n; i++) {
+                    const int error = std::abs(f[i] - q[i]);
+                    max_error = error > max_error ? error : max_error;
+                    error_sum += error;
+                }
+                // Unblended channels are left alone by both
+                samples += static_cast<uint64_t>(width) * bc;
+            }
+        }
+
+        const double mean = static_cast<double>(error_sum) / samples;
+        std::printf("%s _q vs float (%d/%d channels): max %d, mean %.3f\n", k.name, bc, ch,
+                    max_error, mean);
+        if (max_error > kMaxQuantizedError || mean > kMaxMeanQuantizedError) {
+            std::printf("FAIL: %s fixed-point blend drifts from float\n", k.name);
+            failures++;
+        }
+    }
+}
+
+} // namespace
+
+int main()
+{
+    std::mt19937 rng(1234);
+    const Inputs inputs(rng);
+
+    // Only the levels this CPU runs; BACKGROUND_FILTER_ISA can lower it
+    const BlendIsa active = BlendKernelSelect::Active();
+    std::vector<const BlendKernels *> tables;
+#ifdef BLEND_KERNELS_X86
+    if (active >= BlendIsa::SSE41) {
+        tables.push_back(&kBlendKernelsSSE41);
+    }
+    if (active >= BlendIsa::AVX2) {
+        tables.push_back(&kBlendKernelsAVX2);
+    }
+    if (active >= BlendIsa::AVX512) {
+        tables.push_back(&kBlendKernelsAVX512);
+    }
+#endif
+    (void)active;
+
+    for (const BlendKernels *table : tables) {
+        const int before = failures;
+        Compare(*table, inputs);
+        std::printf("%s: %s\n", table->name, failures == before ? "matches scalar" : "differs");
+    }
+    if (tables.empty()) {
+        std::printf("only the scalar table runs here\n");
+    }
+
+    CompareQuantized(kBlendKernelsScalar, inputs);
+    for (const BlendKernels *table : tables) {
+        CompareQuantized(*table, inputs);
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,126 @@
+// Steady-state frames must not allocate: once the first frames of a layout
+// have sized the pool, the tiled blur must find every band buffer it needs.
+// Its planes differ in width and type (I420 chroma is half width, NV12
+// chroma interleaved, YUY2 packed), so this catches planes evicting each
+// other's buffers.
+
+#include "blend-kernels.h"
+#include "frame-compositor.h"
+#include "frame-view.h"
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+constexpr uint32_t kWidth = 1280;
+constexpr uint32_t kHeight = 720;
+constexpr int kMaskSize = 64;
+constexpr int kBlurAmount = 15;
+constexpr int kStripes = 4;
+constexpr int kWarmupFrames = 2;
+constexpr int kFrames = 5;
+
+struct Format {
+    const char *name;
+    enum video_format format;
+};
+
+constexpr Format kFormats[] = {
+        {"I420", VIDEO_FORMAT_I420},
+        {"NV12", VIDEO_FORMAT_NV12},
+        {"YUY2", VIDEO_FORMAT_YUY2},
+        {"I422", VIDEO_FORMAT_I422},
+};
+
+struct Quality {
+    const char *name;
+    BlurQuality quality;
+};
+
+// Fast only tiles radii too small to matter here
+constexpr Quality kQualities[] = {{"balanced", BlurQuality::Balanced},
+                                  {"reference", BlurQuality::Reference}};
+
+int failures = 0;
+
+// Left half background, right half person, so every row blends
+cv::Mat MakeMask()
+{
+    cv::Mat mask(kMaskSize, kMaskSize, CV_32FC1);
+    for (int y = 0; y < kMaskSize; y++) {
+        float *row = mask.ptr<float>(y);
+        for (int x = 0; x < kMaskSize; x++) {
+            row[x] = x < kMaskSize / 2 ? 0.0f : 1.0f;
+        }
+    }
+    return mask;
+}
+
+void FillFrame(struct obs_source_frame *frame)
+{
+    const FrameView view(frame);
+    for (int i = 0; i < view.PlaneCount(); i++) {
+        const PlaneView &plane = view.Plane(i);
+        const size_t row_bytes =
+                static_cast<size_t>(plane.width) * plane.channels * plane.sample_size;
+        for (int y = 0; y < plane.height; y++) {
+            std::memset(plane.Row(y), 16 + (y * 7) % 200, row_bytes);
+        }
+    }
+}
+
+void CheckSteadyState(const Format &format, const Quality &quality, ThreadPool &pool,
+                      const cv::Mat &mask_image)
+{
+    struct obs_source_frame *frame = obs_source_frame_create(format.format, kWidth, kHeight);
+    FrameBufferPool buffers;
+    buffers.Configure(frame);
+    MaskView mask;
+    mask.Reset(&mask_image, 1);
+
+    WorkBudget budget;
+    budget.pool = &pool;
+    budget.stripes = kStripes;
+
+    auto composite = [&]() {
+        FillFrame(frame);
+        Compositor::BlurBackground(frame, mask, kBlurAmount, quality.quality, true, false,
+                                   buffers, budget);
+    };
+
+    for (int i = 0; i < kWarmupFrames; i++) {
+        composite();
+    }
+    const uint64_t warm = buffers.GetAllocationCount();
+    for (int i = 0; i < kFrames; i++) {
+        composite();
+    }
+    const uint64_t allocations = buffers.GetAllocationCount() - warm;
+
+    std::printf("%s %s: %llu allocations over %d tiled frames\n", format.name, quality.name,
+                static_cast<unsigned long long>(allocations), kFrames);
+    if (allocations != 0) {
+        std::printf("FAIL: %s %s tiled blur allocates in steady state\n", format.name,
+                    quality.name);
+        failures++;
+    }
+
+    obs_source_frame_destroy(frame);
+}
+
+} // namespace
+
+int main()
+{
+    // The caller runs a stripe too
+    ThreadPool pool(kStripes - 1);
+    BlendKernelSelect::Init();
+    const cv::Mat mask_image = MakeMask();
+
+    for (const Format &format : kFormats) {
+        for (const Quality &quality : kQualities) {
+            CheckSteadyState(format, quality, pool, mask_image);
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,155 @@
+// Steady-state inference must not touch the heap. Rather than trusting
+// ModelInference's own counter, every heap allocation in the process is
+// counted: malloc and friends are interposed (operator new, OpenCV and
+// ONNX Runtime all end up there), so allocations made inside the session
+// or by cv::Mat count too.
+//
+// Without ONNX Runtime the stand-in model is exercised. With it, a model
+// must be named in BACKGROUND_FILTER_TEST_MODEL; otherwise the test is
+// skipped.
+
+#include "model-inference.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+namespace {
+
+constexpr int kSkip = 77;          // ctest SKIP_RETURN_CODE
+constexpr int kWarmupRuns = 3;     // Buffers, the resize map and ORT's arena settle here
+constexpr int kSteadyRuns = 50;
+
+std::atomic<uint64_t> heap_allocations{0};
+
+} // namespace
+
+#if defined(__GLIBC__)
+extern "C" {
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size)
+{
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    void *p = memalign(alignment, size);
+    if (!p) {
+        return 12; // ENOMEM
+    }
+    *ptr = p;
+    return 0;
+}
+
+void free(void *ptr)
+{
+    __libc_free(ptr);
+}
+
+} // extern "C"
+#endif
+
+int main()
+{
+#if !defined(__GLIBC__)
+    std::printf("skipped: heap allocations are only counted on glibc\n");
+    return kSkip;
+#else
+    ModelInference model;
+
+#ifdef HAVE_ONNXRUNTIME
+    const char *source = std::getenv("BACKGROUND_FILTER_TEST_MODEL");
+    if (!source) {
+        std::printf("skipped: set BACKGROUND_FILTER_TEST_MODEL to an .onnx model\n");
+        return kSkip;
+    }
+
+    // LoadModel only accepts models from the plugin's own directories
+    namespace fs = std::filesystem;
+    const fs::path home = fs::temp_directory_path() / "background-filter-test-home";
+    const fs::path models = home / ".config/obs-studio/plugins/obs-background-filter/data/models";
+    const fs::path model_path = models / "test.onnx";
+    fs::create_directories(models);
+    fs::copy_file(source, model_path, fs::copy_options::overwrite_existing);
+    setenv("HOME", home.c_str(), 1);
+
+    if (!model.LoadModel(model_path.string())) {
+        std::printf("FAIL: could not load %s\n", source);
+        return 1;
+    }
+#endif
+
+    int height, width;
+    model.GetInputShape(height, width);
+
+    // What the sampler hands over: an RGB image at model resolution
+    cv::Mat image(height, width, CV_8UC3);
+    for (int y = 0; y < height; y++) {
+        uint8_t *row = image.ptr<uint8_t>(y);
+        for (int x = 0; x < width * 3; x++) {
+            row[x] = static_cast<uint8_t>(x * 7 + y * 3);
+        }
+    }
+    cv::Mat mask;
+
+    for (int i = 0; i < kWarmupRuns; i++) {
+        if (!model.RunInference(image, mask, 0.5f)) {
+            std::printf("FAIL: inference failed during warm-up\n");
+            return 1;
+        }
+    }
+
+    const uint64_t before = heap_allocations.load();
+    for (int i = 0; i < kSteadyRuns; i++) {
+        if (!model.RunInference(image, mask, 0.5f)) {
+            std::printf("FAIL: inference failed\n");
+            return 1;
+        }
+    }
+    const uint64_t allocations = heap_allocations.load() - before;
+
+    std::printf("%d steady-state runs: %llu heap allocations\n", kSteadyRuns,
+                static_cast<unsigned long long>(allocations));
+    if (allocations != 0) {
+        std::printf("FAIL: steady-state inference allocated\n");
+        return 1;
+    }
+    if (mask.rows == 0 || mask.type() != CV_32FC1) {
+        std::printf("FAIL: no mask produced\n");
+        return 1;
+    }
+    return 0;
+#endif
+}
@@ -0,0 +1,70 @@
+// A stripe that throws must not take the process down or leave tasks
+// running against a finished call: the exception reaches the caller of
+// ParallelFor only after every stripe has returned, whichever thread threw.
+
+#include "thread-pool.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+constexpr int kWorkers = 3;
+constexpr int kStripes = kWorkers + 1;
+constexpr int kRounds = 200;
+
+int failures = 0;
+
+void Check(bool ok, const char *what)
+{
+    if (!ok) {
+        std::printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// Throw from one stripe while the others are still busy; returns whether the
+// exception arrived and no stripe was still running when it did
+bool ThrowFrom(ThreadPool &pool, int throwing)
+{
+    std::atomic<int> running{0};
+    bool caught = false;
+    try {
+        pool.ParallelFor(kStripes * 8, kStripes, [&](int stripe, int, int) {
+            running.fetch_add(1);
+            if (stripe == throwing) {
+                running.fetch_sub(1);
+                throw std::runtime_error("stripe failed");
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            running.fetch_sub(1);
+        });
+    } catch (const std::runtime_error &) {
+        caught = running.load() == 0;
+    }
+    return caught;
+}
+
+} // namespace
+
+int main()
+{
+    ThreadPool pool(kWorkers);
+
+    for (int round = 0; round < kRounds; round++) {
+        // Stripe 0 runs on this thread, the rest on the pool (or here while
+        // helping to drain the queue)
+        Check(ThrowFrom(pool, 0), "exception from the calling thread's stripe");
+        Check(ThrowFrom(pool, 1 + round % kWorkers), "exception from a queued stripe");
+    }
+
+    // The pool is still usable afterwards
+    std::atomic<int> rows{0};
+    pool.ParallelFor(1000, kStripes, [&](int, int begin, int end) { rows += end - begin; });
+    Check(rows.load() == 1000, "every row covered after failures");
+
+    std::printf("%s\n", failures == 0 ? "exceptions reach the caller" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}